@@ -0,0 +1,219 @@
+/* Benchmark of the search server on a synthetic corpus.
+ * Usage: benchmark [option=value]...
+ *   documents, vocabulary, zipf, min_words, max_words, duplicates,
+ *   queries, query_words, minus_words, seed - see CorpusOptions;
+ *   repeats - count of runs of the batch cases (ProcessQueries).
+ * Every case prints one JSON object per line:
+ *   {"case": ..., "operations": ..., "throughput_ops": ..., "p50_us": ..., "p99_us": ..., "peak_rss_kb": ...} */
+
+#include "corpus_generator.h"
+
+#include "../search_server.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    /* Measured durations of the operations of one case.
+     * @param total - time of the whole case, including the time between operations. */
+    struct Measurement
+    {
+        std::vector<Clock::duration> latencies;
+        Clock::duration total{};
+    };
+
+    /* @brief Runs operation(i) for every i in [0, count) and measures every call. */
+    template <typename Operation>
+    Measurement Measure(size_t count, Operation operation)
+    {
+        Measurement measurement;
+        measurement.latencies.reserve(count);
+
+        const Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Clock::time_point operation_start = Clock::now();
+            operation(i);
+            measurement.latencies.push_back(Clock::now() - operation_start);
+        }
+        measurement.total = Clock::now() - start;
+
+        return measurement;
+    }
+
+    double GetPercentileMicroseconds(std::vector<Clock::duration> latencies, double percentile)
+    {
+        if (latencies.empty())
+            return 0.0;
+
+        const size_t index = std::min(latencies.size() - 1, static_cast<size_t>(percentile * latencies.size()));
+        std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+        return std::chrono::duration<double, std::micro>(latencies[index]).count();
+    }
+
+    long GetPeakResidentSetKilobytes()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    /* @param items_per_operation - count of items processed by one operation, for throughput. */
+    void Report(const std::string& name, const Measurement& measurement, size_t items_per_operation = 1)
+    {
+        const double seconds = std::chrono::duration<double>(measurement.total).count();
+        const double items = static_cast<double>(measurement.latencies.size() * items_per_operation);
+
+        std::cout << "{\"case\": \"" << name << "\""
+                  << ", \"operations\": " << measurement.latencies.size()
+                  << ", \"throughput_ops\": " << ((seconds > 0.0) ? items / seconds : 0.0)
+                  << ", \"p50_us\": " << GetPercentileMicroseconds(measurement.latencies, 0.50)
+                  << ", \"p99_us\": " << GetPercentileMicroseconds(measurement.latencies, 0.99)
+                  << ", \"peak_rss_kb\": " << GetPeakResidentSetKilobytes()
+                  << "}" << std::endl;
+    }
+
+    void ParseOption(const std::string& argument, CorpusOptions& options, size_t& repeats)
+    {
+        const size_t separator = argument.find('=');
+        if (separator == std::string::npos)
+            throw std::invalid_argument("Option must be name=value: " + argument);
+
+        const std::string name = argument.substr(0, separator);
+        const std::string value = argument.substr(separator + 1);
+
+        if (name == "documents")
+            options.document_count = std::stoul(value);
+        else if (name == "vocabulary")
+            options.vocabulary_size = std::stoul(value);
+        else if (name == "zipf")
+            options.zipf_exponent = std::stod(value);
+        else if (name == "min_words")
+            options.min_document_words = std::stoul(value);
+        else if (name == "max_words")
+            options.max_document_words = std::stoul(value);
+        else if (name == "duplicates")
+            options.duplicate_share = std::stod(value);
+        else if (name == "queries")
+            options.query_count = std::stoul(value);
+        else if (name == "query_words")
+            options.query_words = std::stoul(value);
+        else if (name == "minus_words")
+            options.minus_word_share = std::stod(value);
+        else if (name == "seed")
+            options.seed = static_cast<uint32_t>(std::stoul(value));
+        else if (name == "repeats")
+            repeats = std::stoul(value);
+        else
+            throw std::invalid_argument("Unknown option: " + name);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    CorpusOptions options;
+    size_t repeats = 5;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            ParseOption(argv[i], options, repeats);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    CorpusGenerator generator(options);
+    const std::vector<std::string> documents = generator.GenerateDocuments();
+    const std::vector<std::string> queries = generator.GenerateQueries();
+    const std::vector<int> ratings = { 1, 2, 3 };
+
+    SearchServer search_server("and with"s);
+    Report("add_document", Measure(documents.size(), [&](size_t i)
+        {
+            search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, ratings);
+        }));
+
+    {
+        std::vector<DocumentInput> inputs(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            inputs[i] = { static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, ratings };
+        }
+
+        SearchServer bulk_server("and with"s);
+        Report("add_documents_par", Measure(1, [&](size_t)
+            {
+                bulk_server.AddDocuments(std::execution::par, inputs);
+            }), documents.size());
+    }
+
+    Report("find_top_documents_seq", Measure(queries.size(), [&](size_t i)
+        {
+            search_server.FindTopDocuments(std::execution::seq, queries[i]);
+        }));
+
+    Report("find_top_documents_par", Measure(queries.size(), [&](size_t i)
+        {
+            search_server.FindTopDocuments(std::execution::par, queries[i]);
+        }));
+
+    Report("match_document_seq", Measure(queries.size(), [&](size_t i)
+        {
+            search_server.MatchDocument(std::execution::seq, queries[i], static_cast<int>(i % documents.size()));
+        }));
+
+    Report("match_document_par", Measure(queries.size(), [&](size_t i)
+        {
+            search_server.MatchDocument(std::execution::par, queries[i], static_cast<int>(i % documents.size()));
+        }));
+
+    Report("process_queries", Measure(repeats, [&](size_t)
+        {
+            ProcessQueries(search_server, queries);
+        }), queries.size());
+
+    // Every tenth document is removed from a copy of the server.
+    {
+        const size_t removed_count = documents.size() / 10;
+
+        SearchServer seq_server = search_server;
+        Report("remove_document_seq", Measure(removed_count, [&](size_t i)
+            {
+                seq_server.RemoveDocument(std::execution::seq, static_cast<int>(i * 10));
+            }));
+
+        SearchServer par_server = search_server;
+        Report("remove_document_par", Measure(removed_count, [&](size_t i)
+            {
+                par_server.RemoveDocument(std::execution::par, static_cast<int>(i * 10));
+            }));
+    }
+
+    {
+        SearchServer server_copy = search_server;
+        Report("remove_duplicates", Measure(1, [&](size_t)
+            {
+                RemoveDuplicates(server_copy);
+            }), documents.size());
+    }
+
+    return EXIT_SUCCESS;
+}
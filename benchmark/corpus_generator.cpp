@@ -0,0 +1,116 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options)
+    : options_(options)
+    , generator_(options.seed)
+{
+    vocabulary_.reserve(options_.vocabulary_size);
+    cumulative_probabilities_.reserve(options_.vocabulary_size);
+
+    double sum = 0.0;
+    for (size_t rank = 1; rank <= options_.vocabulary_size; ++rank)
+    {
+        vocabulary_.push_back(MakeWord(rank));
+        sum += 1.0 / std::pow(static_cast<double>(rank), options_.zipf_exponent);
+        cumulative_probabilities_.push_back(sum);
+    }
+
+    for (double& probability : cumulative_probabilities_)
+    {
+        probability /= sum;
+    }
+}
+
+std::vector<std::string> CorpusGenerator::GenerateDocuments()
+{
+    std::uniform_int_distribution<size_t> length_distribution(options_.min_document_words, options_.max_document_words);
+    std::bernoulli_distribution is_duplicate(options_.duplicate_share);
+
+    std::vector<std::string> documents;
+    documents.reserve(options_.document_count);
+
+    for (size_t i = 0; i < options_.document_count; ++i)
+    {
+        if (!documents.empty() && is_duplicate(generator_))
+        {
+            // The same words in another order.
+            std::uniform_int_distribution<size_t> original_distribution(0, documents.size() - 1);
+            const std::string& original = documents[original_distribution(generator_)];
+
+            std::vector<std::string> words;
+            for (size_t begin = 0, end = 0; begin < original.size(); begin = end + 1)
+            {
+                end = std::min(original.find(' ', begin), original.size());
+                words.push_back(original.substr(begin, end - begin));
+            }
+            std::shuffle(words.begin(), words.end(), generator_);
+
+            std::string document;
+            for (const std::string& word : words)
+            {
+                document += document.empty() ? word : ' ' + word;
+            }
+            documents.push_back(std::move(document));
+            continue;
+        }
+
+        const size_t length = length_distribution(generator_);
+        std::string document;
+        for (size_t j = 0; j < length; ++j)
+        {
+            if (j > 0)
+                document += ' ';
+            document += GenerateWord();
+        }
+        documents.push_back(std::move(document));
+    }
+
+    return documents;
+}
+
+std::vector<std::string> CorpusGenerator::GenerateQueries()
+{
+    std::bernoulli_distribution has_minus_word(options_.minus_word_share);
+
+    std::vector<std::string> queries;
+    queries.reserve(options_.query_count);
+
+    for (size_t i = 0; i < options_.query_count; ++i)
+    {
+        std::string query;
+        for (size_t j = 0; j < options_.query_words; ++j)
+        {
+            if (j > 0)
+                query += ' ';
+            query += GenerateWord();
+        }
+        if (has_minus_word(generator_))
+        {
+            query += " -" + GenerateWord();
+        }
+        queries.push_back(std::move(query));
+    }
+
+    return queries;
+}
+
+const std::string& CorpusGenerator::GenerateWord()
+{
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    const auto it = std::lower_bound(cumulative_probabilities_.begin(), cumulative_probabilities_.end(), distribution(generator_));
+    const size_t rank = std::min(static_cast<size_t>(it - cumulative_probabilities_.begin()), vocabulary_.size() - 1);
+    return vocabulary_[rank];
+}
+
+std::string CorpusGenerator::MakeWord(size_t rank)
+{
+    std::string word;
+    for (; rank > 0; rank /= 26)
+    {
+        word += static_cast<char>('a' + rank % 26);
+    }
+    return word;
+}
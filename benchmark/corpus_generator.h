@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/* @param vocabulary_size - count of distinct words.
+ * @param zipf_exponent - word of rank r is taken with probability proportional to 1 / r^exponent.
+ * @param document_count - count of generated documents.
+ * @param min_document_words, max_document_words - range of the document length in words.
+ * @param duplicate_share - share of documents repeating the words of an earlier document.
+ * @param query_count - count of generated queries.
+ * @param query_words - count of plus words of a query.
+ * @param minus_word_share - probability of a minus word in a query.
+ * @param seed - seed of the random generator, equal seeds give equal corpora. */
+struct CorpusOptions
+{
+    size_t vocabulary_size = 20000;
+    double zipf_exponent = 1.0;
+    size_t document_count = 20000;
+    size_t min_document_words = 20;
+    size_t max_document_words = 200;
+    double duplicate_share = 0.05;
+    size_t query_count = 2000;
+    size_t query_words = 3;
+    double minus_word_share = 0.3;
+    uint32_t seed = 42;
+};
+
+/* @brief Generator of a synthetic corpus for benchmarks.
+ *        Words are drawn from a Zipfian distribution, as in natural text:
+ *        a few words are very frequent and have long posting lists, most are rare. */
+class CorpusGenerator
+{
+public:
+    explicit CorpusGenerator(const CorpusOptions& options);
+
+    /* @return Texts of options.document_count documents. */
+    std::vector<std::string> GenerateDocuments();
+
+    /* @return options.query_count queries, every one has a minus word with probability options.minus_word_share. */
+    std::vector<std::string> GenerateQueries();
+
+private:
+    CorpusOptions options_;
+    std::mt19937_64 generator_;
+    std::vector<std::string> vocabulary_;
+    // Cumulative probabilities of the words by rank.
+    std::vector<double> cumulative_probabilities_;
+
+    const std::string& GenerateWord();
+
+    /* @return Word of the rank, made of lowercase letters. */
+    static std::string MakeWord(size_t rank);
+};
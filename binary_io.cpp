@@ -0,0 +1,40 @@
+#include "binary_io.h"
+
+uint64_t ComputeChecksum(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void BinaryWriter::WriteString(const std::string_view str)
+{
+    Write(static_cast<uint32_t>(str.size()));
+    WriteBytes(str.data(), str.size());
+}
+
+void BinaryWriter::WriteBytes(const void* data, size_t size)
+{
+    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    checksum_ = ComputeChecksum(data, size, checksum_);
+}
+
+std::string_view BinaryReader::ReadString()
+{
+    const uint32_t size = Read<uint32_t>();
+    return { ReadBytes(size), size };
+}
+
+const char* BinaryReader::ReadBytes(size_t size)
+{
+    if (size > data_.size())
+        throw std::runtime_error("Unexpected end of binary data");
+
+    const char* bytes = data_.data();
+    data_.remove_prefix(size);
+    return bytes;
+}
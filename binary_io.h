@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+/* @brief FNV-1a hash, used as the checksum of binary files.
+ * @param data, size - bytes to hash.
+ * @param hash - hash of the preceding bytes, allows hashing in parts.
+ * @return Hash of all bytes. */
+uint64_t ComputeChecksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+
+/* @brief Writer of plain values to a binary stream.
+ *        Values are written in the byte order of the host.
+ *        The checksum of everything written is accumulated on the fly. */
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(std::ostream& out)
+        : out_(out) {}
+
+    template <typename Type>
+    void Write(const Type& value)
+    {
+        static_assert(std::is_trivially_copyable_v<Type>, "BinaryWriter writes only trivially copyable values");
+        WriteBytes(&value, sizeof(Type));
+    }
+
+    /* @brief Writes the length of the string followed by its characters. */
+    void WriteString(const std::string_view str);
+
+    void WriteBytes(const void* data, size_t size);
+
+    inline uint64_t GetChecksum() const noexcept
+    {
+        return checksum_;
+    }
+
+private:
+    std::ostream& out_;
+    uint64_t checksum_ = ComputeChecksum(nullptr, 0);
+};
+
+
+/* @brief Bounds-checked reader of values written by BinaryWriter.
+ *        Reads directly from memory, e.g. from a mapped file.
+ * @throw std::runtime_error on reading past the end of the data. */
+class BinaryReader
+{
+public:
+    explicit BinaryReader(const std::string_view data)
+        : data_(data) {}
+
+    template <typename Type>
+    Type Read()
+    {
+        static_assert(std::is_trivially_copyable_v<Type>, "BinaryReader reads only trivially copyable values");
+        Type value;
+        std::memcpy(&value, ReadBytes(sizeof(Type)), sizeof(Type));
+        return value;
+    }
+
+    /* @return View of the string inside the data. */
+    std::string_view ReadString();
+
+    /* @return Pointer to the next size bytes inside the data. */
+    const char* ReadBytes(size_t size);
+
+    inline bool IsEnd() const noexcept
+    {
+        return data_.empty();
+    }
+
+private:
+    std::string_view data_;
+};
@@ -1,68 +1,213 @@
 #pragma once
 
-#include <future>
+#include <algorithm>
+#include <cstddef>
+#include <execution>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <numeric>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
-#include <mutex>
-#include <algorithm>
 
 using namespace std::string_literals;
 
-template <typename Key, typename Value>
-class ConcurrentMap
+// Size of a cache line, buckets are aligned to it so that their locks do not share a line.
+const size_t CACHE_LINE_SIZE = 64;
+
+/* @brief Hash choosing the bucket of a key in ConcurrentMap.
+ *        Integer keys are used as they are, so consecutive keys go to different buckets.
+ *        Strings are hashed as std::string_view, so a map with std::string keys
+ *        can be searched by any string without building a std::string. */
+template <typename Key, typename = void>
+struct ConcurrentMapHash
 {
-public:
-    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
+    inline size_t operator()(const Key& key) const
+    {
+        return std::hash<Key>{}(key);
+    }
+};
+
+template <typename Key>
+struct ConcurrentMapHash<Key, std::enable_if_t<std::is_integral_v<Key>>>
+{
+    inline size_t operator()(Key key) const noexcept
+    {
+        return static_cast<size_t>(key);
+    }
+};
+
+template <>
+struct ConcurrentMapHash<std::string>
+{
+    inline size_t operator()(std::string_view key) const noexcept
+    {
+        return std::hash<std::string_view>{}(key);
+    }
+};
 
-    struct Bucket
+/* @brief Hash map split into independently locked buckets.
+ *        A bucket is an ordered map under a reader-writer lock: lookups and
+ *        iteration share it, insertion and erasure hold it exclusively.
+ *        Lookups and erasure accept any key comparable with Key that Hash accepts.
+ *        Per-key methods lock only the bucket of the key. Rehash must not run
+ *        concurrently with any other method, all other methods may.
+ *        Methods must not be called while the same thread holds an Access. */
+template <typename Key, typename Value, typename Hash = ConcurrentMapHash<Key>>
+class ConcurrentMap
+{
+private:
+    struct alignas(CACHE_LINE_SIZE) Bucket
     {
-        std::mutex m;
-        std::map<Key, Value> submap;
+        mutable std::shared_mutex mutex;
+        std::map<Key, Value, std::less<>> submap;
     };
 
+public:
+    // Exclusive access to the value of a key, the value is inserted if it is missing.
     struct Access
     {
-        Access(Bucket& bucket, const Key& key)
-            : lg(bucket.m), ref_to_value(bucket.submap[key])
-        {
-        }
-
-        ~Access()
+        Access(ConcurrentMap& map, const Key& key)
+            : bucket(map.GetBucket(key))
+            , bucket_lock(bucket.mutex)
+            , ref_to_value(bucket.submap[key])
         {
         }
 
-        std::lock_guard<std::mutex> lg;
+        Bucket& bucket;
+        std::unique_lock<std::shared_mutex> bucket_lock;
         Value& ref_to_value;
     };
 
-    explicit ConcurrentMap(size_t bucket_count)
-        : bucket_count_(bucket_count), buckets(bucket_count_)
+    explicit ConcurrentMap(size_t bucket_count, Hash hash = Hash())
+        : hash_(std::move(hash))
+        , buckets_(std::max<size_t>(bucket_count, 1))
     {
     }
 
     Access operator[](const Key& key)
     {
-        size_t index = static_cast<size_t>(key) % bucket_count_;
-        return Access(buckets[index], key);
+        return Access(*this, key);
     }
 
-    std::map<Key, Value> BuildOrdinaryMap()
+    /* @return Copy of the value of the key, std::nullopt if the key is missing. */
+    template <typename LookupKey>
+    std::optional<Value> Find(const LookupKey& key) const
     {
-        std::map<Key, Value> result;
-        for (auto& bucket : buckets)
+        const Bucket& bucket = GetBucket(key);
+        std::shared_lock<std::shared_mutex> bucket_lock(bucket.mutex);
+
+        const auto it = bucket.submap.find(key);
+        if (it == bucket.submap.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    template <typename LookupKey>
+    bool Contains(const LookupKey& key) const
+    {
+        const Bucket& bucket = GetBucket(key);
+        std::shared_lock<std::shared_mutex> bucket_lock(bucket.mutex);
+        return bucket.submap.find(key) != bucket.submap.end();
+    }
+
+    /* @return false if the key is missing. */
+    template <typename LookupKey>
+    bool Erase(const LookupKey& key)
+    {
+        Bucket& bucket = GetBucket(key);
+        std::unique_lock<std::shared_mutex> bucket_lock(bucket.mutex);
+
+        const auto it = bucket.submap.find(key);
+        if (it == bucket.submap.end())
+            return false;
+        bucket.submap.erase(it);
+        return true;
+    }
+
+    size_t GetSize() const
+    {
+        size_t size = 0;
+        for (const Bucket& bucket : buckets_)
+        {
+            std::shared_lock<std::shared_mutex> bucket_lock(bucket.mutex);
+            size += bucket.submap.size();
+        }
+        return size;
+    }
+
+    size_t GetBucketCount() const
+    {
+        return buckets_.size();
+    }
+
+    /* @brief Changes the count of buckets. The entries are moved, not copied.
+     *        The caller must own the map exclusively: no other method may run meanwhile. */
+    void Rehash(size_t bucket_count)
+    {
+        std::vector<Bucket> buckets(std::max<size_t>(bucket_count, 1));
+        for (Bucket& bucket : buckets_)
         {
-            std::lock_guard<std::mutex> lg(bucket.m);
-            for (const auto& item : bucket.submap)
+            while (!bucket.submap.empty())
             {
-                result.insert(item);
+                auto node = bucket.submap.extract(bucket.submap.begin());
+                buckets[hash_(node.key()) % buckets.size()].submap.insert(std::move(node));
             }
         }
+        buckets_.swap(buckets);
+    }
+
+    /* @brief Calls function(key, value) for every entry, bucket after bucket.
+     *        Every bucket is locked shared while it is visited, so entries
+     *        changed concurrently in other buckets may be seen or missed. */
+    template <typename Function>
+    void ForEach(Function function) const
+    {
+        for (const Bucket& bucket : buckets_)
+            VisitBucket(bucket, function);
+    }
+
+    /* @brief ForEach visiting the buckets in parallel.
+     *        The function is called concurrently and must not throw. */
+    template <typename Function>
+    void ForEach(const std::execution::parallel_policy&, Function function) const
+    {
+        std::for_each(std::execution::par, buckets_.begin(), buckets_.end(),
+            [&function](const Bucket& bucket) { VisitBucket(bucket, function); });
+    }
+
+    std::map<Key, Value> BuildOrdinaryMap() const
+    {
+        std::map<Key, Value> result;
+        ForEach([&result](const Key& key, const Value& value) { result.emplace(key, value); });
         return result;
     }
 
 private:
-    size_t bucket_count_;
-    std::vector<Bucket> buckets;
-};
\ No newline at end of file
+    Hash hash_;
+    std::vector<Bucket> buckets_;
+
+    template <typename LookupKey>
+    Bucket& GetBucket(const LookupKey& key)
+    {
+        return buckets_[hash_(key) % buckets_.size()];
+    }
+
+    template <typename LookupKey>
+    const Bucket& GetBucket(const LookupKey& key) const
+    {
+        return buckets_[hash_(key) % buckets_.size()];
+    }
+
+    template <typename Function>
+    static void VisitBucket(const Bucket& bucket, Function& function)
+    {
+        std::shared_lock<std::shared_mutex> bucket_lock(bucket.mutex);
+        for (const auto& [key, value] : bucket.submap)
+            function(key, value);
+    }
+};
@@ -0,0 +1,174 @@
+#include "corpus_loader.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <execution>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace
+{
+    // Chunks are cut at the first line end after this size.
+    const size_t CORPUS_CHUNK_SIZE = size_t{ 1 } << 22;
+
+    // Chunks of one call of AddDocuments, this many bytes of the file are indexed at once.
+    const size_t CORPUS_BATCH_CHUNK_COUNT = 16;
+
+    const char CORPUS_FIELD_SEPARATOR = '\t';
+
+    struct Chunk
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    bool ParseInt(std::string_view text, int& value)
+    {
+        const char* const end = text.data() + text.size();
+        const auto [ptr, error] = std::from_chars(text.data(), end, value);
+        return (error == std::errc()) && (ptr == end) && !text.empty();
+    }
+
+    bool ParseStatus(std::string_view text, DocumentStatus& status)
+    {
+        static const std::string_view STATUS_NAMES[] = { "ACTUAL", "IRRELEVANT", "BANNED", "REMOVED" };
+
+        for (size_t i = 0; i < std::size(STATUS_NAMES); ++i)
+        {
+            if (text == STATUS_NAMES[i])
+            {
+                status = static_cast<DocumentStatus>(i);
+                return true;
+            }
+        }
+
+        int number = 0;
+        if (!ParseInt(text, number) || (number < 0) || (number >= static_cast<int>(std::size(STATUS_NAMES))))
+            return false;
+        status = static_cast<DocumentStatus>(number);
+        return true;
+    }
+
+    bool ParseRatings(std::string_view text, std::vector<int>& ratings)
+    {
+        while (!text.empty())
+        {
+            const size_t separator = std::min(text.find(','), text.size());
+            int rating = 0;
+            if (!ParseInt(text.substr(0, separator), rating))
+                return false;
+            ratings.push_back(rating);
+            text.remove_prefix(std::min(separator + 1, text.size()));
+        }
+        return true;
+    }
+
+    /* @brief Cuts the next field off the line.
+     * @return false if the line has no separator left. */
+    bool TakeField(std::string_view& line, std::string_view& field)
+    {
+        const size_t separator = line.find(CORPUS_FIELD_SEPARATOR);
+        if (separator == std::string_view::npos)
+            return false;
+        field = line.substr(0, separator);
+        line.remove_prefix(separator + 1);
+        return true;
+    }
+
+    bool ParseLine(std::string_view line, DocumentInput& document)
+    {
+        std::string_view id;
+        std::string_view status;
+        std::string_view ratings;
+        if (!TakeField(line, id) || !TakeField(line, status) || !TakeField(line, ratings))
+            return false;
+
+        document.text = line;
+        return ParseInt(id, document.id)
+            && ParseStatus(status, document.status)
+            && ParseRatings(ratings, document.ratings);
+    }
+
+    /* @brief Parses the lines of the chunk, texts of the documents point into the contents.
+     * @throw std::runtime_error with the number of the first malformed line. */
+    std::vector<DocumentInput> ParseChunk(std::string_view contents, Chunk chunk)
+    {
+        std::vector<DocumentInput> documents;
+
+        size_t line_begin = chunk.begin;
+        while (line_begin < chunk.end)
+        {
+            const size_t line_end = std::min(contents.find('\n', line_begin), chunk.end);
+            std::string_view line = contents.substr(line_begin, line_end - line_begin);
+            if (!line.empty() && (line.back() == '\r'))
+                line.remove_suffix(1);
+
+            if (!line.empty() && !ParseLine(line, documents.emplace_back()))
+            {
+                // Lines are counted only on failure, chunks do not know their first line.
+                const size_t line_number = std::count(contents.begin(), contents.begin() + line_begin, '\n') + 1;
+                throw std::runtime_error("Malformed corpus line "s + std::to_string(line_number));
+            }
+
+            line_begin = line_end + 1;
+        }
+
+        return documents;
+    }
+
+    /* @return Chunk starting at the offset, ending after a line end or at the end of the contents. */
+    Chunk CutChunk(std::string_view contents, size_t begin)
+    {
+        if (contents.size() - begin <= CORPUS_CHUNK_SIZE)
+            return { begin, contents.size() };
+
+        const size_t line_end = contents.find('\n', begin + CORPUS_CHUNK_SIZE);
+        return { begin, (line_end == std::string_view::npos) ? contents.size() : line_end + 1 };
+    }
+}
+
+size_t LoadCorpus(SearchServer& search_server, const std::string& path)
+{
+    return LoadCorpus(ThreadPool::GetDefault(), search_server, path);
+}
+
+size_t LoadCorpus(ThreadPool& pool, SearchServer& search_server, const std::string& path)
+{
+    const MappedFile file(path);
+    file.AdviseSequential();
+    const std::string_view contents = file.GetContents();
+
+    size_t document_count = 0;
+    std::vector<Chunk> chunks;
+    std::vector<std::vector<DocumentInput>> chunk_documents;
+    std::vector<DocumentInput> batch;
+
+    for (size_t offset = 0; offset < contents.size();)
+    {
+        chunks.clear();
+        while ((offset < contents.size()) && (chunks.size() < CORPUS_BATCH_CHUNK_COUNT))
+        {
+            chunks.push_back(CutChunk(contents, offset));
+            offset = chunks.back().end;
+        }
+
+        chunk_documents.assign(chunks.size(), {});
+        pool.ParallelFor(chunks.size(),
+            [contents, &chunks, &chunk_documents](size_t i)
+            { chunk_documents[i] = ParseChunk(contents, chunks[i]); });
+
+        batch.clear();
+        for (std::vector<DocumentInput>& documents : chunk_documents)
+            std::move(documents.begin(), documents.end(), std::back_inserter(batch));
+
+        search_server.AddDocuments(std::execution::par, batch);
+        document_count += batch.size();
+    }
+
+    return document_count;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "search_server.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <string>
+
+/* @brief Bulk loading of a corpus file into the server.
+ *        Every line of the file is a document of four fields separated by tabs:
+ *            id  status  ratings  text
+ *        status is a name of DocumentStatus (ACTUAL, IRRELEVANT, BANNED, REMOVED) or its number,
+ *        ratings are integers separated by commas and may be empty, text is the rest of the line.
+ *        Empty lines are skipped, "\r\n" line ends are accepted.
+ *
+ *        The file is memory-mapped and split into chunks on line boundaries. The chunks
+ *        are parsed in parallel by the pool into documents whose texts point into the
+ *        mapping, and are added with SearchServer::AddDocuments a batch of chunks at a time,
+ *        so memory besides the mapping does not grow with the size of the file.
+ * @param pool - pool parsing the chunks, ThreadPool::GetDefault() if not given.
+ * @return Count of the added documents.
+ * @throw std::runtime_error if the file can not be read or a line is malformed,
+ *        std::invalid_argument if a document is invalid. Batches read before the
+ *        error stay in the server, nothing of the failed batch is added. */
+size_t LoadCorpus(SearchServer& search_server, const std::string& path);
+
+size_t LoadCorpus(ThreadPool& pool, SearchServer& search_server, const std::string& path);
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <ostream>
+#include <string_view>
+#include <vector>
 
 enum class DocumentStatus
 {
@@ -24,4 +28,73 @@ struct Document
     int rating = 0;
 };
 
+/* @brief Filter of documents by status, rating and id.
+ *        A search server recognizes it at compile time and reads only the
+ *        document fields it restricts, instead of calling a predicate with
+ *        all of them. It is a predicate itself, so it works wherever one is expected. */
+struct DocumentFilter
+{
+    // Bit StatusBit(status) of every accepted status.
+    uint32_t statuses = ALL_STATUSES;
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+    int min_id = std::numeric_limits<int>::min();
+    int max_id = std::numeric_limits<int>::max();
+
+    static constexpr uint32_t ALL_STATUSES = ~uint32_t{ 0 };
+
+    static constexpr uint32_t StatusBit(DocumentStatus status)
+    {
+        return uint32_t{ 1 } << static_cast<int>(status);
+    }
+
+    /* @return Filter of the documents with the status. */
+    static DocumentFilter ForStatus(DocumentStatus status)
+    {
+        DocumentFilter filter;
+        filter.statuses = StatusBit(status);
+        return filter;
+    }
+
+    inline bool IsStatusRestricted() const noexcept
+    {
+        return statuses != ALL_STATUSES;
+    }
+
+    inline bool IsRatingRestricted() const noexcept
+    {
+        return (min_rating != std::numeric_limits<int>::min()) || (max_rating != std::numeric_limits<int>::max());
+    }
+
+    inline bool IsIdRestricted() const noexcept
+    {
+        return (min_id != std::numeric_limits<int>::min()) || (max_id != std::numeric_limits<int>::max());
+    }
+
+    inline bool HasStatus(DocumentStatus status) const noexcept
+    {
+        return (statuses & StatusBit(status)) != 0;
+    }
+
+    inline bool operator()(int document_id, DocumentStatus status, int rating) const noexcept
+    {
+        return HasStatus(status)
+            && (rating >= min_rating) && (rating <= max_rating)
+            && (document_id >= min_id) && (document_id <= max_id);
+    }
+};
+
+/* @brief Document for the bulk addition to a search server.
+ * @param id - id of the added document.
+ * @param text - document content, must stay valid during the addition.
+ * @param status - document status (see definition of "DocumentStatus").
+ * @param ratings - document grades vector. */
+struct DocumentInput
+{
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
\ No newline at end of file
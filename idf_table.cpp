@@ -0,0 +1,73 @@
+#include "idf_table.h"
+
+#include <cmath>
+
+IdfTable::IdfTable(const IdfTable& other)
+    : document_count_(other.document_count_)
+    , document_freqs_(other.document_freqs_)
+    , epoch_(other.epoch_)
+    , dirty_epochs_(other.dirty_epochs_)
+    , dirty_terms_(other.dirty_terms_)
+    , is_dirty_(other.is_dirty_.load())
+    , log_document_count_(other.log_document_count_)
+    , log_document_freqs_(other.log_document_freqs_)
+{
+}
+
+void IdfTable::Resize(size_t term_count)
+{
+    if (document_freqs_.size() < term_count)
+    {
+        document_freqs_.resize(term_count, 0);
+        dirty_epochs_.resize(term_count, 0);
+        log_document_freqs_.resize(term_count, 0.0);
+    }
+}
+
+void IdfTable::SetDocumentCount(size_t document_count)
+{
+    if (document_count_ != document_count)
+    {
+        document_count_ = document_count;
+        is_dirty_.store(true, std::memory_order_relaxed);
+    }
+}
+
+void IdfTable::Add(TermId term, uint32_t document_count)
+{
+    document_freqs_[term] += document_count;
+    MarkDirty(term);
+}
+
+void IdfTable::Remove(TermId term)
+{
+    --document_freqs_[term];
+    MarkDirty(term);
+}
+
+void IdfTable::MarkDirty(TermId term)
+{
+    if (dirty_epochs_[term] != epoch_)
+    {
+        dirty_epochs_[term] = epoch_;
+        dirty_terms_.push_back(term);
+    }
+    is_dirty_.store(true, std::memory_order_relaxed);
+}
+
+void IdfTable::Refresh() const
+{
+    std::lock_guard<std::mutex> lock(refresh_mutex_);
+    if (!is_dirty_.load(std::memory_order_relaxed))
+        return;
+
+    for (const TermId term : dirty_terms_)
+    {
+        log_document_freqs_[term] = (document_freqs_[term] > 0) ? std::log(static_cast<double>(document_freqs_[term])) : 0.0;
+    }
+    dirty_terms_.clear();
+    ++epoch_;
+
+    log_document_count_ = (document_count_ > 0) ? std::log(static_cast<double>(document_count_)) : 0.0;
+    is_dirty_.store(false, std::memory_order_release);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "term_dictionary.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/* @brief Document frequencies of terms with cached inverse document frequencies.
+ *        IDF = log(N / df) is kept as log(N) - log(df), so a change of the document
+ *        count N costs one log() and does not touch the terms. A term whose df
+ *        changed is queued once per epoch and its log(df) is recomputed by the first
+ *        lookup after the update, however many documents of a bulk ingest contain it.
+ *
+ *        Updates must not run concurrently with anything else, lookups may run
+ *        concurrently with each other. */
+class IdfTable
+{
+public:
+    using TermId = TermDictionary::TermId;
+
+    IdfTable() = default;
+
+    IdfTable(const IdfTable& other);
+
+    IdfTable& operator=(const IdfTable&) = delete;
+
+    /* @brief Makes room for terms up to term_count, new terms have df 0. */
+    void Resize(size_t term_count);
+
+    /* @brief Sets the count N of documents in the index. */
+    void SetDocumentCount(size_t document_count);
+
+    /* @brief Adds documents to the df of the term. */
+    void Add(TermId term, uint32_t document_count);
+
+    /* @brief Removes one document from the df of the term. */
+    void Remove(TermId term);
+
+    /* @return Count of documents containing the term. */
+    inline uint32_t GetDocumentFreq(TermId term) const
+    {
+        return document_freqs_[term];
+    }
+
+    /* @param term - term with a non-zero df.
+     * @return IDF of the term. */
+    inline double GetInverseDocumentFreq(TermId term) const
+    {
+        if (is_dirty_.load(std::memory_order_acquire))
+            Refresh();
+        return log_document_count_ - log_document_freqs_[term];
+    }
+
+private:
+    void MarkDirty(TermId term);
+
+    /* @brief Recomputes the queued logarithms, once for all concurrent lookups. */
+    void Refresh() const;
+
+    size_t document_count_ = 0;
+    std::vector<uint32_t> document_freqs_;
+
+    // Epoch in which the term was queued, the queue is emptied by Refresh.
+    // Lookups exclude updates, so Refresh changes the queue without racing with them.
+    mutable uint32_t epoch_ = 1;
+    std::vector<uint32_t> dirty_epochs_;
+    mutable std::vector<TermId> dirty_terms_;
+
+    mutable std::mutex refresh_mutex_;
+    mutable std::atomic<bool> is_dirty_{ false };
+    mutable double log_document_count_ = 0.0;
+    mutable std::vector<double> log_document_freqs_;
+};
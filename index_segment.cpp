@@ -0,0 +1,121 @@
+#include "index_segment.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+IndexSegment::IndexSegment(Ordinal first_document)
+    : first_document_(first_document)
+{
+}
+
+void IndexSegment::Extend(Ordinal end_document)
+{
+    live_count_ += end_document - GetEndDocument();
+    tombstones_.resize(end_document - first_document_, false);
+}
+
+void IndexSegment::Remove(Ordinal document)
+{
+    tombstones_[document - first_document_] = true;
+    --live_count_;
+    ++removed_count_;
+}
+
+const PostingList* IndexSegment::FindPostings(TermId term) const
+{
+    const auto it = term_postings_.find(term);
+    return (it == term_postings_.end()) ? nullptr : &it->second;
+}
+
+PostingList& IndexSegment::GetPostings(TermId term)
+{
+    return term_postings_[term];
+}
+
+IndexSegment IndexSegment::Merge(const std::vector<const IndexSegment*>& segments, const std::vector<bool>& tombstones,
+    const std::vector<double>& inv_word_counts)
+{
+    IndexSegment merged(segments.front()->first_document_);
+    merged.tombstones_ = tombstones;
+    merged.live_count_ = static_cast<size_t>(std::count(tombstones.begin(), tombstones.end(), false));
+
+    // The segments follow each other, so appending them in turn keeps every list sorted.
+    for (const IndexSegment* segment : segments)
+    {
+        for (const auto& [term, postings] : segment->term_postings_)
+        {
+            PostingList* merged_postings = nullptr;
+            for (const auto [document, term_count] : postings)
+            {
+                const size_t position = document - merged.first_document_;
+                if (tombstones[position])
+                    continue;
+
+                if (merged_postings == nullptr)
+                    merged_postings = &merged.term_postings_[term];
+                merged_postings->Append(document, term_count, term_count * inv_word_counts[position]);
+            }
+        }
+    }
+
+    return merged;
+}
+
+void IndexSegment::Save(BinaryWriter& writer) const
+{
+    writer.Write(first_document_);
+    writer.Write(GetEndDocument());
+    writer.Write(static_cast<uint64_t>(removed_count_));
+
+    // Sorted, so that equal indexes produce equal files.
+    std::vector<TermId> terms;
+    terms.reserve(term_postings_.size());
+    for (const auto& [term, _] : term_postings_)
+        terms.push_back(term);
+    std::sort(terms.begin(), terms.end());
+
+    writer.Write(static_cast<uint64_t>(terms.size()));
+    for (const TermId term : terms)
+    {
+        writer.Write(term);
+        term_postings_.at(term).Save(writer);
+    }
+}
+
+IndexSegment IndexSegment::Load(BinaryReader& reader, const std::vector<uint8_t>& live_ordinals, size_t term_count)
+{
+    const Ordinal first_document = reader.Read<Ordinal>();
+    const Ordinal end_document = reader.Read<Ordinal>();
+    if ((first_document > end_document) || (end_document > live_ordinals.size()))
+        throw std::runtime_error("Invalid segment range");
+
+    IndexSegment segment(first_document);
+    segment.tombstones_.resize(end_document - first_document);
+    for (Ordinal document = first_document; document < end_document; ++document)
+    {
+        if (live_ordinals[document] != 0)
+            ++segment.live_count_;
+        else
+            segment.tombstones_[document - first_document] = true;
+    }
+
+    segment.removed_count_ = reader.Read<uint64_t>();
+    if (segment.removed_count_ > segment.tombstones_.size() - segment.live_count_)
+        throw std::runtime_error("Invalid segment removed count");
+
+    const uint64_t list_count = reader.Read<uint64_t>();
+    for (uint64_t i = 0; i < list_count; ++i)
+    {
+        const TermId term = reader.Read<TermId>();
+        if ((term >= term_count) || (segment.term_postings_.count(term) > 0))
+            throw std::runtime_error("Invalid segment term");
+
+        // Postings are checked to be inside of the segment while loading.
+        const PostingList& postings = segment.term_postings_.emplace(term,
+            PostingList::Load(reader, first_document, end_document)).first->second;
+        if (postings.empty())
+            throw std::runtime_error("Empty posting list in segment");
+    }
+
+    return segment;
+}
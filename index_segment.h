@@ -0,0 +1,91 @@
+#pragma once
+
+#include "binary_io.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+/* @brief Part of the inverted index covering a contiguous range of document ordinals.
+ *        Documents are only appended to a segment. A removed document is marked
+ *        in the tombstone bitmap and its postings stay in place until the segment
+ *        is rewritten by Merge, so removal never re-encodes posting lists. */
+class IndexSegment
+{
+public:
+    using Ordinal = PostingList::Ordinal;
+    using TermId = TermDictionary::TermId;
+
+    /* @param first_document - ordinal of the first document of the segment. */
+    explicit IndexSegment(Ordinal first_document);
+
+    inline Ordinal GetFirstDocument() const noexcept
+    {
+        return first_document_;
+    }
+
+    /* @return Ordinal following the last document of the segment. */
+    inline Ordinal GetEndDocument() const noexcept
+    {
+        return static_cast<Ordinal>(first_document_ + tombstones_.size());
+    }
+
+    inline size_t GetLiveCount() const noexcept
+    {
+        return live_count_;
+    }
+
+    /* @return Count of removed documents whose postings are still stored. */
+    inline size_t GetRemovedCount() const noexcept
+    {
+        return removed_count_;
+    }
+
+    inline bool IsRemoved(Ordinal document) const
+    {
+        return tombstones_[document - first_document_];
+    }
+
+    /* @brief Extends the segment by live documents up to end_document. */
+    void Extend(Ordinal end_document);
+
+    /* @brief Marks a live document of the segment as removed. */
+    void Remove(Ordinal document);
+
+    /* @param term - term id, NO_TERM is allowed.
+     * @return Posting list of the term or nullptr if no document of the segment contains it. */
+    const PostingList* FindPostings(TermId term) const;
+
+    /* @brief Posting list of the term for appending, created if missing.
+     *        Lists of different terms may be appended concurrently. */
+    PostingList& GetPostings(TermId term);
+
+    /* @brief Builds one segment from adjacent segments without the removed documents.
+     *        Reads only the posting lists, so it may run without locking while
+     *        the sources are still served, if they are not appended to.
+     * @param segments - segments in the order of ordinals.
+     * @param tombstones - removed flags of all ordinals from the first document
+     *                     of the first segment to the end of the last one.
+     * @param inv_word_counts - inverse word counts of the same documents, to compute TF.
+     * @return Merged segment. */
+    static IndexSegment Merge(const std::vector<const IndexSegment*>& segments, const std::vector<bool>& tombstones,
+        const std::vector<double>& inv_word_counts);
+
+    void Save(BinaryWriter& writer) const;
+
+    /* @param live_ordinals - flags of live documents indexed by ordinal.
+     * @param term_count - count of terms in the dictionary.
+     * @throw std::runtime_error if the segment is inconsistent with the documents. */
+    static IndexSegment Load(BinaryReader& reader, const std::vector<uint8_t>& live_ordinals, size_t term_count);
+
+private:
+    Ordinal first_document_;
+    std::vector<bool> tombstones_;
+    size_t live_count_ = 0;
+    size_t removed_count_ = 0;
+
+    // Only the terms present in the segment have posting lists.
+    std::unordered_map<TermId, PostingList> term_postings_;
+};
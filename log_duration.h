@@ -23,7 +23,7 @@ public:
 
         const auto end_time = Clock::now();
         const auto dur = end_time - start_time_;
-        std::cerr << id_ << ": "s << duration_cast<microseconds>(dur).count() << " ms"s << std::endl;
+        std::cerr << id_ << ": "s << duration_cast<microseconds>(dur).count() << " us"s << std::endl;
     }
 
 private:
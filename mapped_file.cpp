@@ -0,0 +1,116 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        file_ = nullptr;
+        throw std::runtime_error("Can not open file " + path);
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size))
+    {
+        CloseHandle(file_);
+        throw std::runtime_error("Can not get size of file " + path);
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+
+    // An empty file can not be mapped, it is served as an empty view.
+    if (size_ == 0)
+        return;
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr)
+    {
+        CloseHandle(file_);
+        throw std::runtime_error("Can not map file " + path);
+    }
+
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr)
+    {
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+        throw std::runtime_error("Can not map file " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+        UnmapViewOfFile(data_);
+    if (mapping_ != nullptr)
+        CloseHandle(mapping_);
+    if (file_ != nullptr)
+        CloseHandle(file_);
+}
+
+void MappedFile::AdviseSequential() const noexcept
+{
+    // Windows reads mapped files ahead by itself.
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Can not open file " + path);
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Can not get size of file " + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+
+    // An empty file can not be mapped, it is served as an empty view.
+    if (size_ > 0)
+    {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Can not map file " + path);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+        munmap(const_cast<char*>(data_), size_);
+}
+
+void MappedFile::AdviseSequential() const noexcept
+{
+    if (data_ != nullptr)
+        madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/* @brief Read-only memory mapping of a whole file.
+ *        The contents stay valid while the object lives. */
+class MappedFile
+{
+public:
+    /* @param path - path to the file.
+     * @throw std::runtime_error if the file can not be opened or mapped. */
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    inline const char* data() const noexcept
+    {
+        return data_;
+    }
+
+    inline size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    inline std::string_view GetContents() const noexcept
+    {
+        return { data_, size_ };
+    }
+
+    /* @brief Hints that the file is read once from start to end,
+     *        so pages are read ahead and may be dropped after use. */
+    void AdviseSequential() const noexcept;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
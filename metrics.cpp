@@ -0,0 +1,257 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    const char* const STAGE_NAMES[METRIC_STAGE_COUNT] = {
+        "query",
+        "query_parse",
+        "minus_exclusion",
+        "posting_traversal",
+        "top_selection",
+        "add_document",
+        "add_documents",
+        "remove_document",
+    };
+
+    const char* const COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+        "queries",
+        "candidate_documents",
+        "excluded_documents",
+        "filtered_documents",
+        "pruned_documents",
+        "added_documents",
+        "removed_documents",
+    };
+
+    /* Metrics recorded by one thread. Only the owner writes them,
+     * so a value is updated by a plain load and store. */
+    struct ThreadMetrics
+    {
+        std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT>, METRIC_STAGE_COUNT> histograms{};
+        std::array<std::atomic<uint64_t>, METRIC_STAGE_COUNT> total_ns{};
+        std::array<std::atomic<uint64_t>, METRIC_COUNTER_COUNT> counters{};
+    };
+
+    // Sums of the metrics of all threads.
+    struct Totals
+    {
+        std::array<std::array<uint64_t, LatencyHistogram::BUCKET_COUNT>, METRIC_STAGE_COUNT> histograms{};
+        std::array<uint64_t, METRIC_STAGE_COUNT> total_ns{};
+        std::array<uint64_t, METRIC_COUNTER_COUNT> counters{};
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        // Blocks of the running threads.
+        std::vector<ThreadMetrics*> threads;
+        // Sums of the blocks of finished threads.
+        std::unique_ptr<Totals> retired = std::make_unique<Totals>();
+        // Totals at the last reset.
+        std::unique_ptr<Totals> baseline = std::make_unique<Totals>();
+    };
+
+    Registry& GetRegistry()
+    {
+        // Never destroyed, threads may record while the program exits.
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    void AddThread(Totals& totals, const ThreadMetrics& thread_metrics)
+    {
+        for (size_t stage = 0; stage < METRIC_STAGE_COUNT; ++stage)
+        {
+            for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket)
+                totals.histograms[stage][bucket] += thread_metrics.histograms[stage][bucket].load(std::memory_order_relaxed);
+            totals.total_ns[stage] += thread_metrics.total_ns[stage].load(std::memory_order_relaxed);
+        }
+        for (size_t counter = 0; counter < METRIC_COUNTER_COUNT; ++counter)
+            totals.counters[counter] += thread_metrics.counters[counter].load(std::memory_order_relaxed);
+    }
+
+    /* Block of the metrics of the current thread. When the thread finishes,
+     * the block is added to the retired totals and freed, so memory does not
+     * grow with the count of threads ever started. */
+    class ThreadMetricsOwner
+    {
+    public:
+        ThreadMetricsOwner()
+            : thread_metrics_(std::make_unique<ThreadMetrics>())
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.threads.push_back(thread_metrics_.get());
+        }
+
+        ~ThreadMetricsOwner()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            AddThread(*registry.retired, *thread_metrics_);
+            registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), thread_metrics_.get()));
+        }
+
+        inline ThreadMetrics& Get() noexcept
+        {
+            return *thread_metrics_;
+        }
+
+    private:
+        std::unique_ptr<ThreadMetrics> thread_metrics_;
+    };
+
+    ThreadMetrics& GetThreadMetrics()
+    {
+        thread_local ThreadMetricsOwner owner;
+        return owner.Get();
+    }
+
+    inline void Increase(std::atomic<uint64_t>& value, uint64_t increment) noexcept
+    {
+        value.store(value.load(std::memory_order_relaxed) + increment, std::memory_order_relaxed);
+    }
+
+    // Called under the mutex of the registry.
+    std::unique_ptr<Totals> SumThreads(const Registry& registry)
+    {
+        auto totals = std::make_unique<Totals>(*registry.retired);
+        for (const ThreadMetrics* thread_metrics : registry.threads)
+            AddThread(*totals, *thread_metrics);
+        return totals;
+    }
+}
+
+const char* GetMetricName(MetricStage stage)
+{
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+const char* GetMetricName(MetricCounter counter)
+{
+    return COUNTER_NAMES[static_cast<size_t>(counter)];
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t nanoseconds) noexcept
+{
+    if (nanoseconds < SUB_BUCKET_COUNT)
+        return static_cast<size_t>(nanoseconds);
+
+    size_t exponent = 0;
+    for (size_t step = 32; step > 0; step /= 2)
+    {
+        if ((nanoseconds >> (exponent + step)) != 0)
+            exponent += step;
+    }
+
+    const size_t sub_bucket = static_cast<size_t>(nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t bucket) noexcept
+{
+    if (bucket < SUB_BUCKET_COUNT)
+        return bucket;
+
+    const size_t exponent = bucket / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    const uint64_t width = uint64_t{ 1 } << (exponent - SUB_BUCKET_BITS);
+    const uint64_t lower = (SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT) * width;
+    return lower + width / 2;
+}
+
+uint64_t LatencyHistogram::GetPercentile(const std::array<uint64_t, BUCKET_COUNT>& histogram, uint64_t count, double share) noexcept
+{
+    if (count == 0)
+        return 0;
+
+    // Rank of the value, counted from 1.
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(share * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < histogram.size(); ++bucket)
+    {
+        seen += histogram[bucket];
+        if (seen >= rank)
+            return GetBucketValue(bucket);
+    }
+    return 0;
+}
+
+void Metrics::SetEnabled(bool is_enabled) noexcept
+{
+    is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+void Metrics::Record(MetricStage stage, std::chrono::steady_clock::duration duration) noexcept
+{
+    const uint64_t nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    ThreadMetrics& thread_metrics = GetThreadMetrics();
+    Increase(thread_metrics.histograms[static_cast<size_t>(stage)][LatencyHistogram::GetBucket(nanoseconds)], 1);
+    Increase(thread_metrics.total_ns[static_cast<size_t>(stage)], nanoseconds);
+}
+
+void Metrics::Add(MetricCounter counter, uint64_t value) noexcept
+{
+    if (IsEnabled())
+        Increase(GetThreadMetrics().counters[static_cast<size_t>(counter)], value);
+}
+
+MetricsSnapshot Metrics::GetSnapshot()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::unique_ptr<Totals> totals = SumThreads(registry);
+
+    MetricsSnapshot snapshot;
+    for (size_t stage = 0; stage < METRIC_STAGE_COUNT; ++stage)
+    {
+        auto& histogram = totals->histograms[stage];
+        StageStatistics& statistics = snapshot.stages[stage];
+        for (size_t bucket = 0; bucket < histogram.size(); ++bucket)
+        {
+            histogram[bucket] -= registry.baseline->histograms[stage][bucket];
+            statistics.count += histogram[bucket];
+            if (histogram[bucket] != 0)
+                statistics.max_ns = LatencyHistogram::GetBucketValue(bucket);
+        }
+        statistics.total_ns = totals->total_ns[stage] - registry.baseline->total_ns[stage];
+        statistics.p50_ns = LatencyHistogram::GetPercentile(histogram, statistics.count, 0.50);
+        statistics.p99_ns = LatencyHistogram::GetPercentile(histogram, statistics.count, 0.99);
+    }
+    for (size_t counter = 0; counter < METRIC_COUNTER_COUNT; ++counter)
+    {
+        snapshot.counters[counter] = totals->counters[counter] - registry.baseline->counters[counter];
+    }
+
+    return snapshot;
+}
+
+void Metrics::Reset()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.baseline = SumThreads(registry);
+}
+
+std::ostream& operator<<(std::ostream& out, const MetricsSnapshot& snapshot)
+{
+    for (size_t stage = 0; stage < METRIC_STAGE_COUNT; ++stage)
+    {
+        const StageStatistics& statistics = snapshot.stages[stage];
+        out << GetMetricName(static_cast<MetricStage>(stage))
+            << " count=" << statistics.count
+            << " total_ns=" << statistics.total_ns
+            << " p50_ns=" << statistics.p50_ns
+            << " p99_ns=" << statistics.p99_ns
+            << " max_ns=" << statistics.max_ns << '\n';
+    }
+    for (size_t counter = 0; counter < METRIC_COUNTER_COUNT; ++counter)
+    {
+        out << GetMetricName(static_cast<MetricCounter>(counter)) << ' ' << snapshot.counters[counter] << '\n';
+    }
+    return out;
+}
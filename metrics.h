@@ -0,0 +1,181 @@
+#pragma once
+
+#include "log_duration.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Timed stages of the search server.
+enum class MetricStage
+{
+    QUERY,
+    QUERY_PARSE,
+    MINUS_EXCLUSION,
+    POSTING_TRAVERSAL,
+    TOP_SELECTION,
+    ADD_DOCUMENT,
+    ADD_DOCUMENTS,
+    REMOVE_DOCUMENT,
+    COUNT,
+};
+
+/* Counted events of the search server:
+ *   CANDIDATE_DOCUMENTS - postings reached by the parallel search, documents reached by the sequential one;
+ *   EXCLUDED_DOCUMENTS, FILTERED_DOCUMENTS - candidates rejected by minus words and by the predicate;
+ *   PRUNED_DOCUMENTS - candidates the sequential search stopped scoring as they can not enter the top. */
+enum class MetricCounter
+{
+    QUERIES,
+    CANDIDATE_DOCUMENTS,
+    EXCLUDED_DOCUMENTS,
+    FILTERED_DOCUMENTS,
+    PRUNED_DOCUMENTS,
+    ADDED_DOCUMENTS,
+    REMOVED_DOCUMENTS,
+    COUNT,
+};
+
+const size_t METRIC_STAGE_COUNT = static_cast<size_t>(MetricStage::COUNT);
+const size_t METRIC_COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNT);
+
+const char* GetMetricName(MetricStage stage);
+
+const char* GetMetricName(MetricCounter counter);
+
+/* @brief Latency histogram with logarithmic buckets in the manner of HDR histograms.
+ *        Every power of two of nanoseconds is split into SUB_BUCKET_COUNT buckets,
+ *        so a value is known with an error of at most 1 / SUB_BUCKET_COUNT. */
+class LatencyHistogram
+{
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKET_COUNT = size_t{ 1 } << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static size_t GetBucket(uint64_t nanoseconds) noexcept;
+
+    /* @return Middle of the range of the values of the bucket, in nanoseconds. */
+    static uint64_t GetBucketValue(size_t bucket) noexcept;
+
+    /* @param histogram - count of the values of every bucket.
+     * @param count - count of all values of the histogram.
+     * @return Value of the bucket holding the share of the values, 0 if there are none. */
+    static uint64_t GetPercentile(const std::array<uint64_t, BUCKET_COUNT>& histogram, uint64_t count, double share) noexcept;
+};
+
+/* @param count - count of the timed runs of the stage.
+ * @param total_ns - sum of their durations.
+ * @param p50_ns, p99_ns, max_ns - percentiles of the durations, from the histogram. */
+struct StageStatistics
+{
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+/* @brief Metrics of all threads since the start or the last Metrics::Reset. */
+struct MetricsSnapshot
+{
+    std::array<StageStatistics, METRIC_STAGE_COUNT> stages;
+    std::array<uint64_t, METRIC_COUNTER_COUNT> counters{};
+
+    inline const StageStatistics& operator[](MetricStage stage) const
+    {
+        return stages[static_cast<size_t>(stage)];
+    }
+
+    inline uint64_t operator[](MetricCounter counter) const
+    {
+        return counters[static_cast<size_t>(counter)];
+    }
+};
+
+/* @brief Text dump of the snapshot, a line per stage and per counter. */
+std::ostream& operator<<(std::ostream& out, const MetricsSnapshot& snapshot);
+
+/* @brief Process-wide registry of the metrics.
+ *        Every thread writes to its own block of counters and histograms,
+ *        without locks or shared cache lines; blocks are summed on demand.
+ *        Blocks of finished threads are added to common totals and freed,
+ *        so nothing recorded is lost and memory does not grow with the thread count. */
+class Metrics
+{
+public:
+    inline static bool IsEnabled() noexcept
+    {
+        return is_enabled_.load(std::memory_order_relaxed);
+    }
+
+    // Enabled by default. A disabled registry does not read the clock.
+    static void SetEnabled(bool is_enabled) noexcept;
+
+    static void Record(MetricStage stage, std::chrono::steady_clock::duration duration) noexcept;
+
+    static void Add(MetricCounter counter, uint64_t value = 1) noexcept;
+
+    static MetricsSnapshot GetSnapshot();
+
+    /* @brief Starts counting from zero. Snapshots are taken relative to the reset,
+     *        so threads recording meanwhile are not disturbed. */
+    static void Reset();
+
+private:
+    static inline std::atomic<bool> is_enabled_{ true };
+};
+
+/* @brief Records the time from its construction to its destruction as a stage. */
+class StageTimer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /* @param elapsed - where the time is stored as well, may be nullptr.
+     *        It is measured even if the registry is disabled. */
+    explicit StageTimer(MetricStage stage, Clock::duration* elapsed = nullptr) noexcept
+        : stage_(stage)
+        , elapsed_(elapsed)
+        , is_recorded_(Metrics::IsEnabled())
+        , is_running_(is_recorded_ || (elapsed != nullptr))
+    {
+        if (is_running_)
+            start_time_ = Clock::now();
+    }
+
+    StageTimer(const StageTimer&) = delete;
+
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    ~StageTimer()
+    {
+        Stop();
+    }
+
+    /* @brief Records the stage before the destruction, later calls do nothing. */
+    inline void Stop() noexcept
+    {
+        if (!is_running_)
+            return;
+
+        const Clock::duration duration = Clock::now() - start_time_;
+        if (is_recorded_)
+            Metrics::Record(stage_, duration);
+        if (elapsed_ != nullptr)
+            *elapsed_ += duration;
+        is_running_ = false;
+    }
+
+private:
+    const MetricStage stage_;
+    Clock::duration* const elapsed_;
+    const bool is_recorded_;
+    bool is_running_;
+    Clock::time_point start_time_;
+};
+
+#define METRICS_STAGE(stage) StageTimer PROFILE_CONCAT(stageTimer, __LINE__)(stage)
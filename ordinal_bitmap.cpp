@@ -0,0 +1,61 @@
+#include "ordinal_bitmap.h"
+
+#include <algorithm>
+
+void OrdinalBitmap::Insert(Ordinal document)
+{
+    const size_t group = document >> CONTAINER_BITS;
+    const uint16_t value = static_cast<uint16_t>(document);
+
+    if (group >= container_indexes_.size())
+        container_indexes_.resize(group + 1, NO_CONTAINER);
+
+    if (container_indexes_[group] == NO_CONTAINER)
+    {
+        container_indexes_[group] = static_cast<uint32_t>(containers_.size());
+        containers_.emplace_back();
+    }
+
+    Container& container = containers_[container_indexes_[group]];
+    if (container.bitmap.empty())
+    {
+        const auto it = std::lower_bound(container.array.begin(), container.array.end(), value);
+        if ((it != container.array.end()) && (*it == value))
+            return;
+
+        container.array.insert(it, value);
+        ++size_;
+
+        if (container.array.size() > ARRAY_LIMIT)
+        {
+            container.bitmap.assign(BITMAP_WORDS, 0);
+            for (const uint16_t array_value : container.array)
+                container.bitmap[array_value / 64] |= uint64_t{ 1 } << (array_value % 64);
+            container.array = {};
+        }
+        return;
+    }
+
+    uint64_t& word = container.bitmap[value / 64];
+    const uint64_t bit = uint64_t{ 1 } << (value % 64);
+    if ((word & bit) == 0)
+    {
+        word |= bit;
+        ++size_;
+    }
+}
+
+bool OrdinalBitmap::Contains(Ordinal document) const
+{
+    const size_t group = document >> CONTAINER_BITS;
+    if ((group >= container_indexes_.size()) || (container_indexes_[group] == NO_CONTAINER))
+        return false;
+
+    const Container& container = containers_[container_indexes_[group]];
+    const uint16_t value = static_cast<uint16_t>(document);
+
+    if (container.bitmap.empty())
+        return std::binary_search(container.array.begin(), container.array.end(), value);
+
+    return (container.bitmap[value / 64] >> (value % 64)) & 1;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "posting_list.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* @brief Compressed set of document ordinals in the manner of roaring bitmaps.
+ *        Ordinals are grouped by their high 16 bits. A group keeps the low bits
+ *        in a sorted array while it is sparse and turns into a plain bitmap of
+ *        65536 bits once the array would take more memory than the bitmap.
+ *        A lookup costs one table access plus a bit test or a short binary search. */
+class OrdinalBitmap
+{
+public:
+    using Ordinal = PostingList::Ordinal;
+
+    void Insert(Ordinal document);
+
+    bool Contains(Ordinal document) const;
+
+    inline size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    inline bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+private:
+    static constexpr size_t CONTAINER_BITS = 16;
+    static constexpr size_t BITMAP_WORDS = (size_t{ 1 } << CONTAINER_BITS) / 64;
+    // An array of more values takes more memory than the bitmap.
+    static constexpr size_t ARRAY_LIMIT = 4096;
+
+    /* Low bits of the ordinals of one group: the sorted array,
+     * or the bitmap if it is not empty. */
+    struct Container
+    {
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> bitmap;
+    };
+
+    static constexpr uint32_t NO_CONTAINER = UINT32_MAX;
+
+    // Index of the container of every group, NO_CONTAINER for empty groups.
+    std::vector<uint32_t> container_indexes_;
+    std::vector<Container> containers_;
+    size_t size_ = 0;
+};
@@ -0,0 +1,255 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    void WriteVarint(uint32_t value, std::vector<uint8_t>& out)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    float RoundUpToFloat(double value)
+    {
+        const float rounded = static_cast<float>(value);
+        return (rounded < value) ? std::nextafter(rounded, std::numeric_limits<float>::infinity()) : rounded;
+    }
+
+    uint32_t ReadVarint(const uint8_t*& in)
+    {
+        uint32_t value = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            const uint8_t byte = *in++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+    }
+
+    /* @brief ReadVarint for untrusted data.
+     * @throw std::runtime_error if the varint passes the end or does not fit 32 bits. */
+    uint32_t ReadCheckedVarint(const uint8_t*& in, const uint8_t* end)
+    {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            if (in == end)
+                throw std::runtime_error("Posting list varint passes the end of its block");
+
+            const uint8_t byte = *in++;
+            if ((shift == 28) && (byte > 0x0F))
+                throw std::runtime_error("Posting list varint is too long");
+
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        throw std::runtime_error("Posting list varint is too long");
+    }
+}
+
+/*********************************************************
+ ***************   PostingList::Iterator   ***************
+ *********************************************************/
+
+PostingList::Iterator::Iterator(const PostingList& postings, size_t first_block, size_t last_block)
+    : postings_(&postings)
+    , block_(first_block)
+    , last_block_(std::min(last_block, postings.blocks_.size()))
+{
+    LoadBlock();
+}
+
+PostingList::Iterator& PostingList::Iterator::operator++()
+{
+    if (++position_ == block_count_)
+    {
+        ++block_;
+        LoadBlock();
+    }
+    return *this;
+}
+
+void PostingList::Iterator::SkipTo(Ordinal target)
+{
+    if ((block_ >= last_block_) || (buffer_[position_].document >= target))
+        return;
+
+    if (postings_->blocks_[block_].last_document < target)
+    {
+        do
+        {
+            ++block_;
+        } while ((block_ < last_block_) && (postings_->blocks_[block_].last_document < target));
+
+        LoadBlock();
+        if (block_ >= last_block_)
+            return;
+    }
+
+    while (buffer_[position_].document < target)
+    {
+        ++position_;
+    }
+}
+
+void PostingList::Iterator::LoadBlock()
+{
+    position_ = 0;
+    block_count_ = (block_ < last_block_) ? postings_->DecodeBlock(block_, buffer_.data()) : 0;
+}
+
+/*********************************************************
+ *********************   PostingList   *******************
+ *********************************************************/
+
+void PostingList::Append(Ordinal document, uint32_t term_count, double term_freq)
+{
+    if (blocks_.empty() || (blocks_.back().count == BLOCK_SIZE))
+    {
+        blocks_.push_back({ document, document, static_cast<uint32_t>(data_.size()), 0, 0.0f });
+    }
+
+    BlockHeader& block = blocks_.back();
+    WriteVarint(document - block.last_document, data_);
+    WriteVarint(term_count, data_);
+
+    block.last_document = document;
+    ++block.count;
+    block.max_term_freq = std::max(block.max_term_freq, RoundUpToFloat(term_freq));
+    max_term_freq_ = std::max(max_term_freq_, static_cast<double>(block.max_term_freq));
+    ++size_;
+}
+
+double PostingList::GetMaxTermFreq(Ordinal document) const
+{
+    const size_t block = FindBlock(document);
+    return (block == blocks_.size()) ? 0.0 : blocks_[block].max_term_freq;
+}
+
+bool PostingList::Contains(Ordinal document) const
+{
+    const size_t block = FindBlock(document);
+    if (block == blocks_.size())
+        return false;
+
+    const uint8_t* in = data_.data() + blocks_[block].offset;
+    Ordinal current = blocks_[block].first_document;
+    for (uint32_t i = 0; i < blocks_[block].count; ++i)
+    {
+        current += ReadVarint(in);
+        if (current >= document)
+            return current == document;
+        ReadVarint(in);
+    }
+    return false;
+}
+
+size_t PostingList::DecodeBlock(size_t block, Posting* out) const
+{
+    const BlockHeader& header = blocks_[block];
+    const uint8_t* in = data_.data() + header.offset;
+
+    Ordinal current = header.first_document;
+    for (uint32_t i = 0; i < header.count; ++i)
+    {
+        current += ReadVarint(in);
+        out[i] = { current, ReadVarint(in) };
+    }
+    return header.count;
+}
+
+void PostingList::Save(BinaryWriter& writer) const
+{
+    writer.Write(static_cast<uint64_t>(size_));
+    writer.Write(static_cast<uint64_t>(blocks_.size()));
+    writer.Write(static_cast<uint64_t>(data_.size()));
+    writer.WriteBytes(blocks_.data(), blocks_.size() * sizeof(BlockHeader));
+    writer.WriteBytes(data_.data(), data_.size());
+}
+
+PostingList PostingList::Load(BinaryReader& reader, Ordinal first_document, Ordinal end_document)
+{
+    PostingList postings;
+
+    const uint64_t posting_count = reader.Read<uint64_t>();
+    const uint64_t block_count = reader.Read<uint64_t>();
+    const uint64_t data_size = reader.Read<uint64_t>();
+
+    if ((posting_count > std::numeric_limits<Ordinal>::max()) || (block_count > posting_count))
+        throw std::runtime_error("Invalid posting list size");
+
+    const char* blocks = reader.ReadBytes(block_count * sizeof(BlockHeader));
+    const char* data = reader.ReadBytes(data_size);
+
+    postings.blocks_.resize(block_count);
+    std::memcpy(postings.blocks_.data(), blocks, block_count * sizeof(BlockHeader));
+    postings.data_.assign(data, data + data_size);
+    postings.size_ = posting_count;
+
+    // Blocks must tile the data, hold increasing ordinals of the range and decode
+    // exactly as their headers say, so that unchecked decoding is safe afterwards.
+    uint64_t counted_postings = 0;
+    for (size_t i = 0; i < postings.blocks_.size(); ++i)
+    {
+        const BlockHeader& header = postings.blocks_[i];
+        const uint64_t block_begin = header.offset;
+        const uint64_t block_end = (i + 1 < block_count) ? postings.blocks_[i + 1].offset : data_size;
+
+        if ((header.count == 0) || (header.count > BLOCK_SIZE)
+            || !(header.max_term_freq >= 0.0f) || std::isinf(header.max_term_freq)
+            || (header.first_document < first_document) || (header.last_document >= end_document)
+            || (header.first_document > header.last_document)
+            || ((i == 0) && (block_begin != 0)) || (block_begin > block_end) || (block_end > data_size)
+            || ((i > 0) && (postings.blocks_[i - 1].last_document >= header.first_document)))
+        {
+            throw std::runtime_error("Invalid posting list block");
+        }
+
+        const uint8_t* in = postings.data_.data() + block_begin;
+        const uint8_t* const end = postings.data_.data() + block_end;
+        uint64_t document = header.first_document;
+        for (uint32_t j = 0; j < header.count; ++j)
+        {
+            const uint32_t delta = ReadCheckedVarint(in, end);
+            ReadCheckedVarint(in, end);
+
+            // The first posting is the first ordinal of the header, the others follow it strictly.
+            if ((delta == 0) != (j == 0))
+                throw std::runtime_error("Invalid posting list ordinal");
+            document += delta;
+        }
+        if ((in != end) || (document != header.last_document))
+            throw std::runtime_error("Invalid posting list block");
+
+        counted_postings += header.count;
+        postings.max_term_freq_ = std::max(postings.max_term_freq_, static_cast<double>(header.max_term_freq));
+    }
+
+    if ((counted_postings != posting_count) || ((block_count == 0) && (data_size != 0)))
+        throw std::runtime_error("Invalid posting list size");
+
+    return postings;
+}
+
+size_t PostingList::FindBlock(Ordinal document) const
+{
+    // The first block whose last ordinal is not less than the document.
+    const auto it = std::lower_bound(blocks_.begin(), blocks_.end(), document,
+        [](const BlockHeader& header, Ordinal ordinal) { return header.last_document < ordinal; });
+
+    if ((it == blocks_.end()) || (it->first_document > document))
+        return blocks_.size();
+
+    return static_cast<size_t>(it - blocks_.begin());
+}
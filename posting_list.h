@@ -0,0 +1,187 @@
+#pragma once
+
+#include "binary_io.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* @brief Compressed posting list of one term.
+ *        Postings are sorted by document ordinal and grouped in blocks of
+ *        BLOCK_SIZE postings. Inside a block the ordinals are delta-encoded
+ *        and written together with the term counts as varints, so a typical
+ *        posting takes two or three bytes. Block headers keep the first and
+ *        the last ordinal of every block to skip blocks without decoding,
+ *        and the maximum TF of the block to bound scores without decoding. */
+class PostingList
+{
+public:
+    using Ordinal = uint32_t;
+
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    /* @param document - document ordinal;
+     * @param term_count - number of occurrences of the term in the document; */
+    struct Posting
+    {
+        Ordinal document;
+        uint32_t term_count;
+    };
+
+    struct Sentinel
+    {
+    };
+
+    /* @brief Forward iterator over a range of blocks.
+     *        Decodes one block at a time into an internal buffer. */
+    class Iterator
+    {
+    public:
+        Iterator(const PostingList& postings, size_t first_block, size_t last_block);
+
+        inline const Posting& operator*() const noexcept
+        {
+            return buffer_[position_];
+        }
+
+        inline const Posting* operator->() const noexcept
+        {
+            return &buffer_[position_];
+        }
+
+        Iterator& operator++();
+
+        /* @brief Moves to the first posting whose ordinal is not less than the target.
+         *        Blocks that end before the target are skipped without decoding. */
+        void SkipTo(Ordinal target);
+
+        inline bool operator!=(Sentinel) const noexcept
+        {
+            return block_ < last_block_;
+        }
+
+        inline bool operator==(Sentinel sentinel) const noexcept
+        {
+            return !(*this != sentinel);
+        }
+
+    private:
+        void LoadBlock();
+
+        const PostingList* postings_;
+        size_t block_;
+        size_t last_block_;
+        size_t position_ = 0;
+        size_t block_count_ = 0;
+        std::array<Posting, BLOCK_SIZE> buffer_;
+    };
+
+    /* @brief Range of blocks that can be iterated with range-based for. */
+    class BlockRange
+    {
+    public:
+        BlockRange(const PostingList& postings, size_t first_block, size_t last_block)
+            : postings_(postings), first_block_(first_block), last_block_(last_block) {}
+
+        inline Iterator begin() const
+        {
+            return Iterator(postings_, first_block_, last_block_);
+        }
+
+        inline Sentinel end() const noexcept
+        {
+            return {};
+        }
+
+    private:
+        const PostingList& postings_;
+        size_t first_block_;
+        size_t last_block_;
+    };
+
+    /* @brief Adds a posting to the end of the list.
+     * @param document - ordinal greater than every ordinal in the list.
+     * @param term_count - number of occurrences of the term in the document.
+     * @param term_freq - TF of the term in the document, only its maximum is kept. */
+    void Append(Ordinal document, uint32_t term_count, double term_freq);
+
+    /* @brief Membership check that decodes at most one block. */
+    bool Contains(Ordinal document) const;
+
+    inline size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    inline bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    inline size_t GetBlockCount() const noexcept
+    {
+        return blocks_.size();
+    }
+
+    /* @return Upper bound of TF of the term in the documents of the list. */
+    inline double GetMaxTermFreq() const noexcept
+    {
+        return max_term_freq_;
+    }
+
+    /* @return Upper bound of TF of the term in the document, 0 if no block may contain it.
+     *         Only block headers are read. */
+    double GetMaxTermFreq(Ordinal document) const;
+
+    /* @return Postings of the blocks [first_block, last_block). */
+    inline BlockRange GetBlocks(size_t first_block, size_t last_block) const
+    {
+        return BlockRange(*this, first_block, last_block);
+    }
+
+    inline Iterator begin() const
+    {
+        return Iterator(*this, 0, blocks_.size());
+    }
+
+    inline Sentinel end() const noexcept
+    {
+        return {};
+    }
+
+    /* @brief Decodes one block.
+     * @param block - block index.
+     * @param out - buffer for at least BLOCK_SIZE postings.
+     * @return Count of decoded postings. */
+    size_t DecodeBlock(size_t block, Posting* out) const;
+
+    /* @brief Writes the encoded blocks as they are. */
+    void Save(BinaryWriter& writer) const;
+
+    /* @brief Reads a posting list written by Save without re-encoding it.
+     *        Every block is decoded once with bounds checks, so a loaded list
+     *        never reads outside of its data and holds only ordinals of the range.
+     * @param first_document, end_document - range of the ordinals of the postings.
+     * @throw std::runtime_error if the data is inconsistent. */
+    static PostingList Load(BinaryReader& reader, Ordinal first_document, Ordinal end_document);
+
+private:
+    struct BlockHeader
+    {
+        Ordinal first_document;
+        Ordinal last_document;
+        uint32_t offset;
+        uint32_t count;
+        // Rounded up, so it is never less than TF of a posting of the block.
+        float max_term_freq;
+    };
+
+    /* @return Index of the only block that may contain the document or GetBlockCount(). */
+    size_t FindBlock(Ordinal document) const;
+
+    std::vector<BlockHeader> blocks_;
+    std::vector<uint8_t> data_;
+    size_t size_ = 0;
+    double max_term_freq_ = 0.0;
+};
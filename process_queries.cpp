@@ -1,37 +1,74 @@
 #include "process_queries.h"
 
-#include <algorithm>
-#include <execution>
-#include <functional>
-#include <numeric>
+#include <chrono>
+
+namespace
+{
+    std::vector<std::vector<Document>> RunQueries(
+        ThreadPool& pool,
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries,
+        RequestTracker* tracker)
+    {
+        std::vector<std::vector<Document>> result(queries.size());
+
+        pool.ParallelFor(queries.size(),
+            [&search_server, &queries, &result, tracker](size_t i)
+            {
+                const auto start_time = std::chrono::steady_clock::now();
+                result[i] = search_server.FindTopDocuments(queries[i]);
+                if (tracker)
+                    tracker->Record(result[i].empty(), std::chrono::steady_clock::now() - start_time);
+            });
+
+        return result;
+    }
+}
+
+JoinedDocuments::JoinedDocuments(std::vector<std::vector<Document>> queries)
+    : queries_(std::move(queries))
+{
+    for (const std::vector<Document>& documents : queries_)
+    {
+        size_ += documents.size();
+    }
+}
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries)
 {
-    std::vector<std::vector<Document>> result(queries.size());
-
-    std::transform(std::execution::par,
-        queries.begin(),
-        queries.end(),
-        result.begin(),
-        [&search_server](const std::string& query)
-        { return search_server.FindTopDocuments(query); });
-
-    return result;
+    return ProcessQueries(ThreadPool::GetDefault(), search_server, queries);
 }
 
-std::list<Document> ProcessQueriesJoined(
+std::vector<std::vector<Document>> ProcessQueries(
+    ThreadPool& pool,
     const SearchServer& search_server,
     const std::vector<std::string>& queries)
 {
-    std::vector<std::vector<Document>> res_queries = ProcessQueries(search_server, queries);
+    return RunQueries(pool, search_server, queries, nullptr);
+}
 
-     std::list<Document> result;
+std::vector<std::vector<Document>> ProcessQueries(
+    ThreadPool& pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    RequestTracker& tracker)
+{
+    return RunQueries(pool, search_server, queries, &tracker);
+}
 
-     std::for_each(res_queries.begin(), res_queries.end(),
-         [&result](std::vector<Document>& val)
-         { result.insert(result.end(), val.begin(), val.end()); });
+JoinedDocuments ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries)
+{
+    return ProcessQueriesJoined(ThreadPool::GetDefault(), search_server, queries);
+}
 
-     return result;
-}
\ No newline at end of file
+JoinedDocuments ProcessQueriesJoined(
+    ThreadPool& pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries)
+{
+    return JoinedDocuments(ProcessQueries(pool, search_server, queries));
+}
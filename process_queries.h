@@ -1,15 +1,140 @@
 #pragma once
 
+#include <cstddef>
+#include <iterator>
 #include <vector>
 #include <string>
-#include <list>
 
+#include "request_tracker.h"
 #include "search_server.h"
+#include "thread_pool.h"
+
+/* @brief Documents found by a batch of queries as one sequence.
+ *        The results are not copied: iteration walks the documents of every
+ *        query in turn, skipping queries that found nothing. */
+class JoinedDocuments
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator() = default;
+
+        Iterator(const std::vector<std::vector<Document>>* queries, size_t query, size_t document)
+            : queries_(queries)
+            , query_(query)
+            , document_(document)
+        {
+            SkipEmptyQueries();
+        }
+
+        inline reference operator*() const
+        {
+            return (*queries_)[query_][document_];
+        }
+
+        inline pointer operator->() const
+        {
+            return &**this;
+        }
+
+        inline Iterator& operator++()
+        {
+            ++document_;
+            SkipEmptyQueries();
+            return *this;
+        }
+
+        inline Iterator operator++(int)
+        {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        inline bool operator==(const Iterator& other) const noexcept
+        {
+            return (query_ == other.query_) && (document_ == other.document_);
+        }
+
+        inline bool operator!=(const Iterator& other) const noexcept
+        {
+            return !(*this == other);
+        }
+
+    private:
+        void SkipEmptyQueries()
+        {
+            while ((query_ < queries_->size()) && (document_ == (*queries_)[query_].size()))
+            {
+                ++query_;
+                document_ = 0;
+            }
+        }
+
+        const std::vector<std::vector<Document>>* queries_ = nullptr;
+        size_t query_ = 0;
+        size_t document_ = 0;
+    };
+
+    explicit JoinedDocuments(std::vector<std::vector<Document>> queries);
+
+    inline Iterator begin() const
+    {
+        return Iterator(&queries_, 0, 0);
+    }
+
+    inline Iterator end() const
+    {
+        return Iterator(&queries_, queries_.size(), 0);
+    }
+
+    inline size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    inline bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+private:
+    std::vector<std::vector<Document>> queries_;
+    size_t size_ = 0;
+};
+
+/* @brief Search by a batch of queries, every query is a task of the thread pool.
+ * @param pool - pool running the queries, ThreadPool::GetDefault() if not given.
+ * @return Top documents of every query, in the order of the queries. */
+std::vector<std::vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
 
 std::vector<std::vector<Document>> ProcessQueries(
+    ThreadPool& pool,
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
-std::list<Document> ProcessQueriesJoined(
+/* @brief ProcessQueries recording every query in the tracker from the worker threads. */
+std::vector<std::vector<Document>> ProcessQueries(
+    ThreadPool& pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    RequestTracker& tracker);
+
+/* @return Top documents of all queries, in the order of the queries. */
+JoinedDocuments ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries);
+
+JoinedDocuments ProcessQueriesJoined(
+    ThreadPool& pool,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
@@ -0,0 +1,101 @@
+#include "query_cache.h"
+
+QueryCache::QueryCache(size_t capacity)
+    : capacity_(capacity)
+{
+}
+
+QueryCache::QueryCache(const QueryCache& other)
+    : capacity_(other.capacity_.load())
+{
+}
+
+void QueryCache::SetCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    Evict();
+}
+
+uint64_t QueryCache::GetGeneration() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+}
+
+void QueryCache::Invalidate()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+}
+
+std::optional<std::vector<Document>> QueryCache::Find(std::string_view key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    DropStale();
+
+    const auto it = entry_by_key_.find(key);
+    if (it == entry_by_key_.end())
+    {
+        ++misses_;
+        return std::nullopt;
+    }
+
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->documents;
+}
+
+void QueryCache::Insert(std::string key, uint64_t generation, std::vector<Document> documents)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    DropStale();
+    if ((capacity_ == 0) || (generation != generation_))
+        return;
+
+    // A concurrent query may have cached the same result.
+    if (entry_by_key_.count(key) > 0)
+        return;
+
+    entries_.push_front({ std::move(key), std::move(documents) });
+    entry_by_key_.emplace(entries_.front().key, entries_.begin());
+    memory_bytes_ += GetEntrySize(entries_.front());
+    Evict();
+}
+
+QueryCache::Statistics QueryCache::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Statistics statistics;
+    statistics.hits = hits_;
+    statistics.misses = misses_;
+    statistics.entry_count = (entries_generation_ == generation_) ? entries_.size() : 0;
+    statistics.memory_bytes = (entries_generation_ == generation_) ? memory_bytes_ : 0;
+    return statistics;
+}
+
+size_t QueryCache::GetEntrySize(const Entry& entry) noexcept
+{
+    return ENTRY_OVERHEAD + entry.key.capacity() + entry.documents.capacity() * sizeof(Document);
+}
+
+void QueryCache::DropStale()
+{
+    if (entries_generation_ == generation_)
+        return;
+
+    entry_by_key_.clear();
+    entries_.clear();
+    memory_bytes_ = 0;
+    entries_generation_ = generation_;
+}
+
+void QueryCache::Evict()
+{
+    while (entries_.size() > capacity_.load())
+    {
+        memory_bytes_ -= GetEntrySize(entries_.back());
+        entry_by_key_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
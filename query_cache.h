@@ -0,0 +1,102 @@
+#pragma once
+
+#include "document.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* @brief Size-bounded LRU cache of query results.
+ *        Every change of the index bumps the generation of the cache, which
+ *        drops all results at the next access, so a result is never served
+ *        after a change it does not reflect. Methods may be called concurrently. */
+class QueryCache
+{
+public:
+    /* @param hits, misses - lookups since the cache was created.
+     * @param entry_count - count of cached results.
+     * @param memory_bytes - approximate memory taken by the cached results. */
+    struct Statistics
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entry_count = 0;
+        size_t memory_bytes = 0;
+
+        inline double GetHitRate() const noexcept
+        {
+            return (hits + misses == 0) ? 0.0 : static_cast<double>(hits) / (hits + misses);
+        }
+    };
+
+    /* @param capacity - maximum count of cached results, 0 disables the cache. */
+    explicit QueryCache(size_t capacity = 0);
+
+    // A copy has the same capacity and starts empty.
+    QueryCache(const QueryCache& other);
+
+    QueryCache& operator=(const QueryCache&) = delete;
+
+    /* @brief Changes the maximum count of cached results, evicting the least recently used. */
+    void SetCapacity(size_t capacity);
+
+    inline bool IsEnabled() const noexcept
+    {
+        return capacity_.load(std::memory_order_relaxed) != 0;
+    }
+
+    /* @return Current generation, to be taken before the result is computed. */
+    uint64_t GetGeneration() const;
+
+    /* @brief Invalidates all cached results. Called on every change of the index. */
+    void Invalidate();
+
+    /* @return Cached result of the query or nothing. */
+    std::optional<std::vector<Document>> Find(std::string_view key);
+
+    /* @brief Caches the result of the query computed at the generation.
+     *        A result of an older generation is not cached. */
+    void Insert(std::string key, uint64_t generation, std::vector<Document> documents);
+
+    Statistics GetStatistics() const;
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::vector<Document> documents;
+    };
+
+    // Besides the strings and documents, an entry takes a list node and a hash table node.
+    static constexpr size_t ENTRY_OVERHEAD = sizeof(Entry) + 6 * sizeof(void*) + sizeof(std::string_view);
+
+    static size_t GetEntrySize(const Entry& entry) noexcept;
+
+    /* @brief Drops the results of older generations. Called under the mutex. */
+    void DropStale();
+
+    /* @brief Evicts the least recently used results beyond the capacity. Called under the mutex. */
+    void Evict();
+
+    mutable std::mutex mutex_;
+    // Changed under the mutex, read without it by IsEnabled.
+    std::atomic<size_t> capacity_;
+    uint64_t generation_ = 0;
+    // Generation of the cached results.
+    uint64_t entries_generation_ = 0;
+
+    // From the most to the least recently used, the map points into the list.
+    std::list<Entry> entries_;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> entry_by_key_;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    size_t memory_bytes_ = 0;
+};
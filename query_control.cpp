@@ -0,0 +1,37 @@
+#include "query_control.h"
+
+QueryCancelledError::QueryCancelledError()
+    : std::runtime_error("query is cancelled")
+{
+}
+
+QueryDeadlineError::QueryDeadlineError()
+    : std::runtime_error("query deadline is exceeded")
+{
+}
+
+CancellationToken::CancellationToken()
+    : is_cancelled_(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+QueryControl QueryControl::WithTimeout(Clock::duration timeout)
+{
+    QueryControl control;
+    control.deadline = Clock::now() + timeout;
+    return control;
+}
+
+bool QueryControl::IsStopped() const noexcept
+{
+    return cancellation.IsCancelled() || ((deadline != Clock::time_point::max()) && (Clock::now() >= deadline));
+}
+
+void QueryControl::ThrowIfStopped() const
+{
+    if (cancellation.IsCancelled())
+        throw QueryCancelledError();
+
+    if ((deadline != Clock::time_point::max()) && (Clock::now() >= deadline))
+        throw QueryDeadlineError();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+/* @brief Thrown by a query that was cancelled before it finished. */
+class QueryCancelledError : public std::runtime_error
+{
+public:
+    QueryCancelledError();
+};
+
+/* @brief Thrown by a query that did not finish before its deadline. */
+class QueryDeadlineError : public std::runtime_error
+{
+public:
+    QueryDeadlineError();
+};
+
+/* @brief Shared flag of cancellation of queries.
+ *        Copies share the flag, so a copy kept by the caller cancels
+ *        the queries holding the other copies. Methods may be called concurrently. */
+class CancellationToken
+{
+public:
+    CancellationToken();
+
+    inline void Cancel() noexcept
+    {
+        is_cancelled_->store(true, std::memory_order_relaxed);
+    }
+
+    inline bool IsCancelled() const noexcept
+    {
+        return is_cancelled_->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> is_cancelled_;
+};
+
+/* @brief Cancellation and deadline of one query.
+ *        A query checks them before it starts and periodically while it scores,
+ *        so it stops within a bounded count of postings.
+ * @param cancellation - cancels the query.
+ * @param deadline - the query is stopped once it is passed, no deadline by default. */
+struct QueryControl
+{
+    using Clock = std::chrono::steady_clock;
+
+    CancellationToken cancellation;
+    Clock::time_point deadline = Clock::time_point::max();
+
+    /* @return Control with the deadline after the timeout from now. */
+    static QueryControl WithTimeout(Clock::duration timeout);
+
+    /* @return Whether the query is cancelled or its deadline is passed. */
+    bool IsStopped() const noexcept;
+
+    /* @throw QueryCancelledError if the query is cancelled,
+     *        QueryDeadlineError if the deadline is passed. */
+    void ThrowIfStopped() const;
+};
@@ -0,0 +1,40 @@
+#include "query_profile.h"
+
+namespace
+{
+    void PrintTerms(std::ostream& out, const char* name, const std::vector<QueryProfile::Term>& terms)
+    {
+        for (const QueryProfile::Term& term : terms)
+        {
+            out << name << ' ' << term.word
+                << " postings=" << term.posting_count
+                << " idf=" << term.inverse_document_freq << '\n';
+        }
+    }
+}
+
+std::ostream& operator<<(std::ostream& out, const QueryProfile& profile)
+{
+    PrintTerms(out, "plus", profile.plus_terms);
+    PrintTerms(out, "minus", profile.minus_terms);
+    for (const std::string& word : profile.stop_words)
+    {
+        out << "stop " << word << '\n';
+    }
+
+    out << "documents candidate=" << profile.candidate_documents
+        << " excluded=" << profile.excluded_documents
+        << " filtered=" << profile.filtered_documents
+        << " pruned=" << profile.pruned_documents
+        << " scored=" << profile.scored_documents << '\n';
+
+    for (size_t stage = 0; stage < METRIC_STAGE_COUNT; ++stage)
+    {
+        if (profile.stage_times[stage] == QueryProfile::Duration::zero())
+            continue;
+
+        out << "time " << GetMetricName(static_cast<MetricStage>(stage)) << ' '
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(profile.stage_times[stage]).count() << " ns\n";
+    }
+    return out;
+}
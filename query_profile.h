@@ -0,0 +1,57 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* @brief Execution trace of one query, filled by SearchServer::ExplainTopDocuments.
+ *        Document counts follow the definitions of MetricCounter. */
+struct QueryProfile
+{
+    using Duration = std::chrono::steady_clock::duration;
+
+    /* @param word - query word.
+     * @param posting_count - postings of the word in all segments, including removed documents.
+     * @param inverse_document_freq - IDF of the word, 0 for minus words and missing words. */
+    struct Term
+    {
+        std::string word;
+        size_t posting_count = 0;
+        double inverse_document_freq = 0.0;
+    };
+
+    std::vector<Term> plus_terms;
+    std::vector<Term> minus_terms;
+    // Words of the query dropped as stop words.
+    std::vector<std::string> stop_words;
+
+    uint64_t candidate_documents = 0;
+    uint64_t excluded_documents = 0;
+    uint64_t filtered_documents = 0;
+    uint64_t pruned_documents = 0;
+    // Documents whose relevance was computed in full.
+    uint64_t scored_documents = 0;
+
+    // Time of every stage, indexed by MetricStage. Stages the query did not run stay zero.
+    std::array<Duration, METRIC_STAGE_COUNT> stage_times{};
+
+    inline Duration GetStageTime(MetricStage stage) const
+    {
+        return stage_times[static_cast<size_t>(stage)];
+    }
+
+    /* @return Where StageTimer stores the time of the stage, nullptr without a profile. */
+    static inline Duration* GetStageTimeTarget(QueryProfile* profile, MetricStage stage)
+    {
+        return (profile == nullptr) ? nullptr : &profile->stage_times[static_cast<size_t>(stage)];
+    }
+};
+
+/* @brief Text dump of the profile: terms, document counts and the time of the stages. */
+std::ostream& operator<<(std::ostream& out, const QueryProfile& profile);
@@ -1,38 +1,211 @@
 #include "remove_duplicates.h"
+#include "word_hash.h"
 
-#include <iostream>
-#include <map>
+#include <algorithm>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
-#include <set>
-#include <string>
 
-void RemoveDuplicates(SearchServer& search_server)
+namespace
 {
-    std::vector<int> documents_to_deleted; // @param int - document_id.
-    std::map<std::set<std::string_view>, int> documents;
+    const size_t MINHASH_BAND_SIZE = MINHASH_SIGNATURE_SIZE / MINHASH_BAND_COUNT;
 
-    for (const int document_id : search_server)
+    static_assert(MINHASH_SIGNATURE_SIZE % MINHASH_BAND_COUNT == 0, "Signature must split into equal bands");
+
+    bool HasSameWords(const WordFrequencies& lhs, const WordFrequencies& rhs)
+    {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+            [](const WordFrequency& lhs_word, const WordFrequency& rhs_word) { return lhs_word.word == rhs_word.word; });
+    }
+
+    double ComputeJaccardSimilarity(const WordFrequencies& lhs, const WordFrequencies& rhs)
     {
-        std::set<std::string_view> doc_words;
+        if (lhs.empty() && rhs.empty())
+            return 1.0;
+
+        // Both views are sorted by word.
+        size_t common_count = 0;
+        auto lhs_it = lhs.begin();
+        auto rhs_it = rhs.begin();
+        while ((lhs_it != lhs.end()) && (rhs_it != rhs.end()))
+        {
+            if (lhs_it->word < rhs_it->word)
+            {
+                ++lhs_it;
+            }
+            else if (rhs_it->word < lhs_it->word)
+            {
+                ++rhs_it;
+            }
+            else
+            {
+                ++common_count;
+                ++lhs_it;
+                ++rhs_it;
+            }
+        }
+
+        return static_cast<double>(common_count) / (lhs.size() + rhs.size() - common_count);
+    }
+
+    /* @return Minimum of every of MINHASH_SIGNATURE_SIZE hash functions over the words. */
+    std::vector<uint64_t> ComputeMinHashSignature(const WordFrequencies& word_frequencies)
+    {
+        std::vector<uint64_t> signature(MINHASH_SIGNATURE_SIZE, std::numeric_limits<uint64_t>::max());
+        for (const WordFrequency& word_frequency : word_frequencies)
+        {
+            const uint64_t word_hash = HashWord(word_frequency.word);
+            for (size_t i = 0; i < MINHASH_SIGNATURE_SIZE; ++i)
+            {
+                signature[i] = std::min(signature[i], MixHash(word_hash ^ (i * 0xD6E8FEB86659FD93ull)));
+            }
+        }
+        return signature;
+    }
 
-        auto doc_frequencies = search_server.GetWordFrequencies(document_id);
+    /* @return Key of the bucket of a band: documents with equal bands share the key. */
+    uint64_t ComputeBandKey(const std::vector<uint64_t>& signature, size_t band)
+    {
+        uint64_t key = band;
+        for (size_t i = band * MINHASH_BAND_SIZE; i < (band + 1) * MINHASH_BAND_SIZE; ++i)
+        {
+            key = MixHash(key ^ signature[i]);
+        }
+        return key;
+    }
 
-        std::transform(doc_frequencies.begin(), doc_frequencies.end(),
-            std::inserter(doc_words, doc_words.end()), [](auto word) {return word.first; });
+    std::vector<int> RemoveDocuments(SearchServer& search_server, const std::vector<int>& document_ids,
+        const std::vector<bool>& is_removed)
+    {
+        std::vector<int> removed_ids;
+        for (size_t i = 0; i < document_ids.size(); ++i)
+        {
+            if (is_removed[i])
+                removed_ids.push_back(document_ids[i]);
+        }
 
-        if (documents.count(doc_words))
+        for (const int document_id : removed_ids)
         {
-            documents_to_deleted.push_back(document_id);
-            std::cout << "Found duplicate document id " << document_id << std::endl;
+            search_server.RemoveDocument(document_id);
         }
-        else
+        return removed_ids;
+    }
+}
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server)
+{
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t document_count = document_ids.size();
+
+    std::vector<WordFrequencies> word_frequencies(document_count);
+    std::vector<uint64_t> fingerprints(document_count);
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), word_frequencies.begin(),
+        [&search_server](int document_id) { return search_server.GetWordFrequencies(document_id); });
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), fingerprints.begin(),
+        [&search_server](int document_id) { return search_server.GetDocumentFingerprint(document_id); });
+
+    // The first document of every fingerprint, documents are in the order of ids.
+    std::vector<size_t> originals(document_count);
+    std::unordered_map<uint64_t, size_t> original_by_fingerprint;
+    original_by_fingerprint.reserve(document_count);
+    for (size_t i = 0; i < document_count; ++i)
+    {
+        originals[i] = original_by_fingerprint.emplace(fingerprints[i], i).first->second;
+    }
+
+    std::vector<size_t> positions(document_count);
+    std::iota(positions.begin(), positions.end(), 0);
+
+    std::vector<char> is_confirmed(document_count, 0);
+    std::for_each(std::execution::par, positions.begin(), positions.end(),
+        [&originals, &word_frequencies, &is_confirmed](size_t i)
         {
-            documents.emplace(doc_words, document_id);
+            is_confirmed[i] = (originals[i] == i) || HasSameWords(word_frequencies[originals[i]], word_frequencies[i]);
+        });
+
+    std::vector<bool> is_removed(document_count, false);
+    std::unordered_map<uint64_t, std::vector<size_t>> colliding_originals;
+    for (size_t i = 0; i < document_count; ++i)
+    {
+        if (originals[i] == i)
+            continue;
+
+        if (is_confirmed[i])
+        {
+            is_removed[i] = true;
+            continue;
         }
+
+        // A fingerprint shared by different sets of words: the document is compared
+        // with every kept document of the fingerprint.
+        std::vector<size_t>& kept = colliding_originals[fingerprints[i]];
+        is_removed[i] = std::any_of(kept.begin(), kept.end(),
+            [&word_frequencies, i](size_t original) { return HasSameWords(word_frequencies[original], word_frequencies[i]); });
+        if (!is_removed[i])
+            kept.push_back(i);
     }
 
-    for (const int document_id : documents_to_deleted)
+    return RemoveDocuments(search_server, document_ids, is_removed);
+}
+
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server, double similarity_threshold)
+{
+    if (!(similarity_threshold > 0.0) || (similarity_threshold > 1.0))
+        throw std::invalid_argument("Similarity threshold must be in (0, 1]");
+
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t document_count = document_ids.size();
+
+    std::vector<WordFrequencies> word_frequencies(document_count);
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), word_frequencies.begin(),
+        [&search_server](int document_id) { return search_server.GetWordFrequencies(document_id); });
+
+    std::vector<std::vector<uint64_t>> band_keys(document_count);
+    std::transform(std::execution::par, word_frequencies.begin(), word_frequencies.end(), band_keys.begin(),
+        [](const WordFrequencies& document_words)
+        {
+            const std::vector<uint64_t> signature = ComputeMinHashSignature(document_words);
+            std::vector<uint64_t> keys(MINHASH_BAND_COUNT);
+            for (size_t band = 0; band < MINHASH_BAND_COUNT; ++band)
+            {
+                keys[band] = ComputeBandKey(signature, band);
+            }
+            return keys;
+        });
+
+    // Kept documents by the keys of their bands.
+    std::unordered_map<uint64_t, std::vector<size_t>> kept_by_band;
+    std::vector<bool> is_removed(document_count, false);
+    std::vector<size_t> candidates;
+
+    for (size_t i = 0; i < document_count; ++i)
     {
-        search_server.RemoveDocument(document_id);
+        candidates.clear();
+        for (const uint64_t key : band_keys[i])
+        {
+            const auto it = kept_by_band.find(key);
+            if (it != kept_by_band.end())
+                candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        is_removed[i] = std::any_of(candidates.begin(), candidates.end(),
+            [&word_frequencies, similarity_threshold, i](size_t candidate)
+            {
+                return ComputeJaccardSimilarity(word_frequencies[candidate], word_frequencies[i]) >= similarity_threshold;
+            });
+
+        if (!is_removed[i])
+        {
+            for (const uint64_t key : band_keys[i])
+                kept_by_band[key].push_back(i);
+        }
     }
+
+    return RemoveDocuments(search_server, document_ids, is_removed);
 }
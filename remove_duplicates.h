@@ -2,7 +2,30 @@
 
 #include "search_server.h"
 
+#include <vector>
+
+// Count of MinHash values in the signature of a document.
+const size_t MINHASH_SIGNATURE_SIZE = 128;
+
+// Count of bands the signature is split into, documents sharing a band are compared.
+const size_t MINHASH_BAND_COUNT = 32;
+
 /* @brief Find and remove duplicates function.
+ *        A duplicate has the same set of words as a document with a lower id.
+ *        Documents are grouped by their fingerprints in one pass, the words of
+ *        the documents of a group are compared in parallel.
  * @param [in] search_server - the server from which you want to remove duplicates.
- * @param [out] search_server - the server from which the duplicates were removed. */
-void RemoveDuplicates(SearchServer& search_server);
+ * @param [out] search_server - the server from which the duplicates were removed.
+ * @return Ids of the removed documents, ascending. */
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
+
+/* @brief Find and remove near duplicates.
+ *        A near duplicate has the Jaccard similarity of its set of words with a kept
+ *        document of a lower id at least similarity_threshold. Candidates are found by
+ *        MinHash signatures split into MINHASH_BAND_COUNT bands (locality-sensitive
+ *        hashing), then the similarity is computed exactly. Pairs less similar than
+ *        about 0.5 are rarely candidates, so lower thresholds miss some of them.
+ * @param similarity_threshold - minimum similarity of a near duplicate, in (0, 1].
+ * @return Ids of the removed documents, ascending.
+ * @throw std::invalid_argument if the threshold is out of range. */
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server, double similarity_threshold);
@@ -1,16 +1,21 @@
 #pragma once
 
 #include "search_server.h"
+#include "request_tracker.h"
 
+#include <chrono>
 #include <vector>
 #include <string>
-#include <deque>
 
+/* @brief Search that keeps the statistics of its requests for the last window of time.
+ *        Requests may be added from several threads at once. */
 class RequestQueue
 {
 public:
-    explicit RequestQueue(const SearchServer& search_server)
-        : search_server_(search_server) {}
+    explicit RequestQueue(const SearchServer& search_server,
+                          std::chrono::seconds window = RequestTracker::DEFAULT_WINDOW)
+        : search_server_(search_server)
+        , tracker_(window) {}
 
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query,
@@ -20,39 +25,31 @@ public:
 
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
-    inline int GetNoResultRequests() const noexcept
+    /* @return Count of the requests of the window that found nothing. */
+    int GetNoResultRequests() const;
+
+    inline RequestStatistics GetStatistics() const
     {
-        return no_result_requests_count;
+        return tracker_.GetStatistics();
     }
 
-private:
-    struct QueryResult
+    /* @brief Tracker of the requests, for requests made elsewhere, e.g. by ProcessQueries. */
+    inline RequestTracker& GetTracker() noexcept
     {
-        bool empty = false;
-        long long timestamp = 0;
-    };
-
-    void UpdateRequests(bool is_last_result_empty);
-
-    void RemoveOldRequests();
-
-    std::deque<QueryResult> requests_;
-
-    // максимальное количество запросов в день
-    const static int sec_in_day_ = 1440;
-    // количество нулевых результатов за день
-    int no_result_requests_count = 0;
-    // общее количество запросов за день
-    long long timestamp = 0;
+        return tracker_;
+    }
 
+private:
     const SearchServer& search_server_;
+    RequestTracker tracker_;
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
     DocumentPredicate document_predicate)
 {
+    const auto start_time = std::chrono::steady_clock::now();
     auto documents = search_server_.FindTopDocuments(raw_query, document_predicate);
-    UpdateRequests(documents.empty());
+    tracker_.Record(documents.empty(), std::chrono::steady_clock::now() - start_time);
     return documents;
-}
\ No newline at end of file
+}
@@ -0,0 +1,93 @@
+#include "request_tracker.h"
+
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+RequestTracker::RequestTracker(std::chrono::seconds window)
+{
+    if (window.count() < 1)
+        throw std::invalid_argument("Window of requests is shorter than a second"s);
+
+    bucket_count_ = static_cast<size_t>(window.count());
+    buckets_ = std::make_unique<Bucket[]>(bucket_count_);
+}
+
+void RequestTracker::Record(bool is_empty, std::chrono::steady_clock::duration latency, Clock::time_point time) noexcept
+{
+    const int64_t second = GetSecond(time);
+    Bucket& bucket = GetBucket(second);
+
+    if ((bucket.second.load(std::memory_order_acquire) != second) && !TakeBucket(bucket, second))
+        return;
+
+    const uint64_t nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+    bucket.request_count.fetch_add(1, std::memory_order_relaxed);
+    if (is_empty)
+        bucket.no_result_count.fetch_add(1, std::memory_order_relaxed);
+    bucket.total_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+    bucket.latencies[LatencyHistogram::GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+RequestStatistics RequestTracker::GetStatistics(Clock::time_point time) const
+{
+    const int64_t last_second = GetSecond(time);
+    const int64_t first_second = last_second - static_cast<int64_t>(bucket_count_) + 1;
+
+    RequestStatistics statistics;
+    std::array<uint64_t, LatencyHistogram::BUCKET_COUNT> latencies{};
+
+    for (size_t i = 0; i < bucket_count_; ++i)
+    {
+        const Bucket& bucket = buckets_[i];
+        const int64_t second = bucket.second.load(std::memory_order_acquire);
+        if ((second < first_second) || (second > last_second))
+            continue;
+
+        statistics.request_count += bucket.request_count.load(std::memory_order_relaxed);
+        statistics.no_result_count += bucket.no_result_count.load(std::memory_order_relaxed);
+        statistics.total_ns += bucket.total_ns.load(std::memory_order_relaxed);
+        for (size_t latency = 0; latency < latencies.size(); ++latency)
+            latencies[latency] += bucket.latencies[latency].load(std::memory_order_relaxed);
+    }
+
+    // The histogram is read apart from the count, so its own total is used for the percentiles.
+    uint64_t latency_count = 0;
+    for (size_t latency = 0; latency < latencies.size(); ++latency)
+    {
+        latency_count += latencies[latency];
+        if (latencies[latency] != 0)
+            statistics.max_ns = LatencyHistogram::GetBucketValue(latency);
+    }
+    statistics.p50_ns = LatencyHistogram::GetPercentile(latencies, latency_count, 0.50);
+    statistics.p99_ns = LatencyHistogram::GetPercentile(latencies, latency_count, 0.99);
+
+    return statistics;
+}
+
+int64_t RequestTracker::GetSecond(Clock::time_point time) noexcept
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+bool RequestTracker::TakeBucket(Bucket& bucket, int64_t second) noexcept
+{
+    std::lock_guard<std::mutex> lock(bucket.mutex);
+
+    const int64_t bucket_second = bucket.second.load(std::memory_order_relaxed);
+    if (bucket_second > second)
+        return false;
+    if (bucket_second == second)
+        return true;
+
+    // Requests of the old second still being added may leak into the new one,
+    // it takes a thread stalled for the whole window.
+    bucket.request_count.store(0, std::memory_order_relaxed);
+    bucket.no_result_count.store(0, std::memory_order_relaxed);
+    bucket.total_ns.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint32_t>& latency : bucket.latencies)
+        latency.store(0, std::memory_order_relaxed);
+
+    bucket.second.store(second, std::memory_order_release);
+    return true;
+}
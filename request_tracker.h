@@ -0,0 +1,87 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+/* @param request_count - requests of the window.
+ * @param no_result_count - requests of the window that found nothing.
+ * @param total_ns - sum of their latencies.
+ * @param p50_ns, p99_ns, max_ns - percentiles of the latencies, from the histogram. */
+struct RequestStatistics
+{
+    uint64_t request_count = 0;
+    uint64_t no_result_count = 0;
+    uint64_t total_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+/* @brief Statistics of the requests of the last window of wall-clock time.
+ *        Requests are counted in a ring of per-second buckets, so a query of the
+ *        statistics reads every bucket once, however many requests there were.
+ *        Requests are recorded concurrently with atomic additions; a bucket is
+ *        locked only when it is taken over by a new second.
+ *        A bucket takes about 2 KB, a window of an hour takes 7 MB. */
+class RequestTracker
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    static constexpr std::chrono::seconds DEFAULT_WINDOW = std::chrono::minutes(10);
+
+    /* @throw std::invalid_argument if the window is shorter than a second. */
+    explicit RequestTracker(std::chrono::seconds window = DEFAULT_WINDOW);
+
+    /* @param is_empty - whether the request found nothing.
+     * @param latency - time of the request.
+     * @param time - when the request was made. Requests older than the
+     *        second kept in their bucket are not recorded. */
+    void Record(bool is_empty, std::chrono::steady_clock::duration latency, Clock::time_point time = Clock::now()) noexcept;
+
+    /* @return Statistics of the requests of the window ending at the time, the second of the time included.
+     *         Requests recorded meanwhile may be seen or missed. */
+    RequestStatistics GetStatistics(Clock::time_point time = Clock::now()) const;
+
+    inline std::chrono::seconds GetWindow() const noexcept
+    {
+        return std::chrono::seconds(bucket_count_);
+    }
+
+private:
+    static constexpr int64_t NO_SECOND = std::numeric_limits<int64_t>::min();
+
+    struct alignas(64) Bucket
+    {
+        // Second of the bucket since the epoch, NO_SECOND before the first request.
+        std::atomic<int64_t> second{ NO_SECOND };
+        // Held while the bucket is cleared for a new second.
+        std::mutex mutex;
+        std::atomic<uint64_t> request_count{ 0 };
+        std::atomic<uint64_t> no_result_count{ 0 };
+        std::atomic<uint64_t> total_ns{ 0 };
+        std::array<std::atomic<uint32_t>, LatencyHistogram::BUCKET_COUNT> latencies{};
+    };
+
+    static int64_t GetSecond(Clock::time_point time) noexcept;
+
+    inline Bucket& GetBucket(int64_t second) noexcept
+    {
+        const int64_t count = static_cast<int64_t>(bucket_count_);
+        return buckets_[static_cast<size_t>((second % count + count) % count)];
+    }
+
+    /* @return false if the bucket already belongs to a later second. */
+    static bool TakeBucket(Bucket& bucket, int64_t second) noexcept;
+
+    size_t bucket_count_;
+    std::unique_ptr<Bucket[]> buckets_;
+};
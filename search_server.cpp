@@ -1,11 +1,67 @@
 #include "search_server.h"
 #include "string_processing.h"
+#include "binary_io.h"
+#include "mapped_file.h"
 
 #include <stdexcept>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <numeric>
+#include <unordered_set>
+
+namespace
+{
+    const char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+
+    // Must be increased on every change of the snapshot layout.
+    const uint32_t SNAPSHOT_VERSION = 4;
+
+    /* Snapshot file: this header followed by the payload.
+     * The payload is written in the byte order of the host:
+     *   - stop words;
+     *   - terms in the order of their ids;
+     *   - document columns indexed by ordinal and the flags of live ordinals;
+     *   - forward index: count of words of every ordinal, then term ids and TF of all words;
+     *   - document frequencies of the terms in the order of their ids;
+     *   - index segments in the order of ordinals. */
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t payload_size;
+        uint64_t checksum;
+    };
+
+    // Count of documents in one partial inverted index of AddDocuments.
+    const size_t INGEST_CHUNK_SIZE = 1024;
+
+    // Count of term ranges merged concurrently by AddDocuments.
+    const size_t INGEST_MERGE_TASK_COUNT = 64;
+
+    template <typename Type>
+    void WriteColumn(BinaryWriter& writer, const std::vector<Type>& column)
+    {
+        writer.WriteBytes(column.data(), column.size() * sizeof(Type));
+    }
+
+    template <typename Type>
+    void ReadColumn(BinaryReader& reader, std::vector<Type>& column, size_t size)
+    {
+        // The bytes are taken first, so a corrupted size fails before the allocation.
+        if (size > std::numeric_limits<size_t>::max() / sizeof(Type))
+            throw std::runtime_error("Invalid column size in snapshot");
+        const char* data = reader.ReadBytes(size * sizeof(Type));
+
+        column.resize(size);
+        std::memcpy(column.data(), data, size * sizeof(Type));
+    }
+}
 
 /*********************************************************
  ***************   Public class members   ****************
@@ -16,9 +72,46 @@ SearchServer::SearchServer(const std::string_view stop_words_text)
 {
 }
 
+SearchServer::SearchServer(const SearchServer& other)
+    : merge_(other.merge_)
+    , index_mutex_(other.index_mutex_)
+    , update_mutex_(other.update_mutex_)
+    , document_ids_(other.document_ids_)
+    , stop_words_(other.stop_words_)
+    , terms_(other.terms_)
+    , segments_(other.segments_)
+    , idfs_(other.idfs_)
+    , document_ordinals_(other.document_ordinals_)
+    , documents_(other.documents_)
+    , query_cache_(other.query_cache_)
+{
+    // Entries of the source point at the words of its dictionary, so they are not shared.
+    document_to_word_freqs_.reserve(other.document_to_word_freqs_.size());
+    for (const auto& source_entries : other.document_to_word_freqs_)
+    {
+        if (!source_entries)
+        {
+            document_to_word_freqs_.emplace_back();
+            continue;
+        }
+
+        WordFrequencies::Entries entries(*source_entries);
+        for (WordFrequency& entry : entries)
+        {
+            entry.word = terms_.GetTerm(terms_.Find(entry.word));
+        }
+        document_to_word_freqs_.push_back(std::make_shared<const WordFrequencies::Entries>(std::move(entries)));
+    }
+}
+
 SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))
+    : SearchServer(std::string_view{ stop_words_text })
+{
+}
+
+SearchServer::~SearchServer()
 {
+    merge_.Wait();
 }
 
 void SearchServer::AddDocument(int document_id,
@@ -26,29 +119,91 @@ void SearchServer::AddDocument(int document_id,
                                DocumentStatus status,
                                const std::vector<int>& ratings)
 {
-    if ((document_id < 0) || (documents_.count(document_id) > 0))
+    METRICS_STAGE(MetricStage::ADD_DOCUMENT);
+
+    if (document_id < 0)
     {
         throw std::invalid_argument("Invalid document_id");
     }
 
-    const std::vector<std::string> words = SplitIntoWordsNoStop(document);
+    // Tokenization does not read the index, so queries are not blocked by it.
+    const std::vector<std::string_view> words = SplitIntoWordsNoStop(document);
 
     // TF calculation for each word of the document.
     const double inv_word_count = 1.0 / words.size();
-    for (const std::string& word : words)
+
+    std::lock_guard<std::shared_mutex> update_lock(update_mutex_);
+    std::lock_guard<std::shared_mutex> lock(index_mutex_);
+    if (document_ordinals_.count(document_id) > 0)
+    {
+        throw std::invalid_argument("Invalid document_id");
+    }
+
+    // Each time a word is repeated in a document, the frequency increases.
+    // Equal term ids are adjacent after sorting, so they are counted without a map.
+    std::vector<TermDictionary::TermId> document_terms(words.size());
+    std::transform(words.begin(), words.end(), document_terms.begin(),
+        [this](const std::string_view word) { return terms_.Intern(word); });
+    std::sort(document_terms.begin(), document_terms.end());
+
+    // Ordinals only grow, so appending keeps every posting list sorted.
+    const Ordinal ordinal = static_cast<Ordinal>(documents_.ids.size());
+
+    IndexSegment& segment = segments_.back();
+    segment.Extend(ordinal + 1);
+    idfs_.Resize(terms_.size());
+
+    WordFrequencies::Entries word_freqs;
+    word_freqs.reserve(document_terms.size());
+    uint64_t fingerprint = 0;
+    for (auto it = document_terms.begin(); it != document_terms.end();)
     {
-        // Each time a word is repeated in a document, the frequency increases.
-        document_to_word_freqs_[document_id][word] += inv_word_count;
-        word_to_document_freqs_[word][document_id] += inv_word_count;
+        const TermDictionary::TermId term = *it;
+        const auto term_end = std::find_if(it, document_terms.end(),
+            [term](TermDictionary::TermId other) { return other != term; });
+        const uint32_t term_count = static_cast<uint32_t>(term_end - it);
+
+        word_freqs.push_back({ terms_.GetTerm(term), term_count * inv_word_count });
+        fingerprint += HashWord(terms_.GetTerm(term));
+        segment.GetPostings(term).Append(ordinal, term_count, term_count * inv_word_count);
+        idfs_.Add(term, 1);
+        it = term_end;
     }
 
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+    document_to_word_freqs_.push_back(WordFrequencies::MakeEntries(std::move(word_freqs)));
+    documents_.ids.push_back(document_id);
+    documents_.ratings.push_back(ComputeAverageRating(ratings));
+    documents_.statuses.push_back(status);
+    documents_.inv_word_counts.push_back(inv_word_count);
+    documents_.fingerprints.push_back(fingerprint);
+    document_ordinals_.emplace(document_id, ordinal);
     document_ids_.insert(document_id);
+    idfs_.SetDocumentCount(document_ordinals_.size());
+    query_cache_.Invalidate();
+    Metrics::Add(MetricCounter::ADDED_DOCUMENTS);
+
+    SealTailSegment();
+}
+
+void SearchServer::AddDocuments(const std::vector<DocumentInput>& documents)
+{
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::sequenced_policy& policy, const std::vector<DocumentInput>& documents)
+{
+    AddDocumentBatch(policy, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::parallel_policy& policy, const std::vector<DocumentInput>& documents)
+{
+    AddDocumentBatch(policy, documents);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+    size_t top_count) const
 {
-    return FindTopDocuments(std::execution::seq, raw_query, status);
+    return FindTopDocuments(std::execution::seq, raw_query, status, top_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const
@@ -56,78 +211,112 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_
     return FindTopDocuments(std::execution::seq, raw_query);
 }
 
+std::pair<std::vector<Document>, QueryProfile> SearchServer::ExplainTopDocuments(const std::string_view raw_query) const
+{
+    return ExplainTopDocuments(std::execution::seq, raw_query, DocumentFilter::ForStatus(DocumentStatus::ACTUAL));
+}
+
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsync(std::string raw_query,
+    DocumentFilter filter, size_t top_count, QueryControl control) const
+{
+    // ThreadPool tasks must be copyable, so the promise is shared with the task.
+    auto promise = std::make_shared<std::promise<std::vector<Document>>>();
+    std::future<std::vector<Document>> result = promise->get_future();
+
+    ThreadPool::GetDefault().Submit(
+        [this, promise, raw_query = std::move(raw_query), filter, top_count, control = std::move(control)]()
+        {
+            try
+            {
+                promise->set_value(RunQuery(std::execution::seq, raw_query, filter, top_count, &control, nullptr));
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        });
+
+    return result;
+}
+
+std::vector<std::future<std::vector<Document>>> SearchServer::FindTopDocumentsAsync(
+    const std::vector<std::string>& raw_queries, DocumentFilter filter, size_t top_count, QueryControl control) const
+{
+    std::vector<std::future<std::vector<Document>>> results;
+    results.reserve(raw_queries.size());
+
+    for (const std::string& raw_query : raw_queries)
+        results.push_back(FindTopDocumentsAsync(raw_query, filter, top_count, control));
+
+    return results;
+}
+
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
     const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const
 {
-    const auto query = ParseQuery(raw_query);
+    const auto query = ParseQuery(raw_query, nullptr);
+
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    const Ordinal document = GetOrdinal(document_id);
+    const IndexSegment& segment = FindSegment(document);
     std::vector<std::string_view> matched_words;
 
     for (const std::string_view word : query.plus_words)
     {
-        if (word_to_document_freqs_.count(std::string{ word }) == 0)
+        const PostingList* postings = segment.FindPostings(terms_.Find(word));
+        if (postings == nullptr)
             continue;
 
-        if (word_to_document_freqs_.at(std::string{ word }).count(document_id))
+        if (postings->Contains(document))
             matched_words.push_back(word);
     }
 
     // Checking for the absence of minus words in the document.
     for (const std::string_view word : query.minus_words)
     {
-        if (word_to_document_freqs_.count(std::string{ word }) == 0)
+        const PostingList* postings = segment.FindPostings(terms_.Find(word));
+        if (postings == nullptr)
             continue;
 
-        if (word_to_document_freqs_.at(std::string{ word }).count(document_id))
+        if (postings->Contains(document))
         {
             matched_words.clear();
             break;
         }
     }
 
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, documents_.statuses[document] };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
     const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const
 {
-    if (document_ids_.count(document_id) == 0)
-        throw std::out_of_range("non-existing document_id");
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    const Ordinal document = GetOrdinal(document_id);
+    const IndexSegment& segment = FindSegment(document);
 
-    const auto query = ParseQuery(raw_query);
-    std::vector<std::string_view> matched_words(word_to_document_freqs_.size());
+    const auto query = ParseQuery(raw_query, nullptr);
+    std::vector<std::string_view> matched_words(query.plus_words.size());
 
-    size_t words_size = 0;
-    std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-        matched_words.begin(),
-        [this, &words_size, document_id](const auto word)
-        {
-            if (word_to_document_freqs_.count(word) == 0)
-            {
-                return false;
-            }
-            else if (word_to_document_freqs_.at(std::string{ word }).count(document_id) > 0)
-            {
-                words_size++;
-                return true;
-            }
-            else
-            {
-                return false;
-            }
-        });
+    const auto is_in_document = [this, &segment, document](const std::string_view word)
+    {
+        const PostingList* postings = segment.FindPostings(terms_.Find(word));
+        return (postings != nullptr) && postings->Contains(document);
+    };
+
+    const auto matched_end = std::copy_if(std::execution::par,
+        query.plus_words.begin(), query.plus_words.end(),
+        matched_words.begin(), is_in_document);
 
-    matched_words.resize(words_size);
+    matched_words.erase(matched_end, matched_words.end());
 
     if (std::any_of(std::execution::par,
-        query.minus_words.begin(), query.minus_words.end(),
-        [=](const auto word) {return
-        (word_to_document_freqs_.count(word) == 0) ?
-        false : (word_to_document_freqs_.at(std::string{ word }).count(document_id) > 0); })
-        ) {
+        query.minus_words.begin(), query.minus_words.end(), is_in_document))
+    {
         matched_words.clear();
     }
 
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, documents_.statuses[document] };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
@@ -137,22 +326,18 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 }
 
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
 {
-    static std::map<std::string_view, double> word_frequencies;
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
 
-    word_frequencies.clear();
-
-    if (documents_.count(document_id) == 0)
-        return word_frequencies;
-
-    for (const auto& [word, freq] : document_to_word_freqs_.at(document_id))
-    {
-        std::string_view tmp{ word };
-        word_frequencies.emplace(tmp, freq);
-    }
+    const auto it = document_ordinals_.find(document_id);
+    return (it == document_ordinals_.end()) ? WordFrequencies() : WordFrequencies(document_to_word_freqs_[it->second]);
+}
 
-    return word_frequencies;
+uint64_t SearchServer::GetDocumentFingerprint(int document_id) const
+{
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    return documents_.fingerprints[GetOrdinal(document_id)];
 }
 
 void SearchServer::RemoveDocument(int document_id)
@@ -162,71 +347,581 @@ void SearchServer::RemoveDocument(int document_id)
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id)
 {
-    if (documents_.count(document_id) == 0)
-        return;
+    METRICS_STAGE(MetricStage::REMOVE_DOCUMENT);
+    std::lock_guard<std::shared_mutex> lock(index_mutex_);
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end())
+        return;
 
-    for (auto& [str_view, _] : GetWordFrequencies(document_id))
+    const Ordinal document = it->second;
+    for (const WordFrequency& word_freq : *document_to_word_freqs_[document])
     {
-        std::string word{ str_view };
-        word_to_document_freqs_.at(word).erase(document_id);
-
-        if (word_to_document_freqs_.at(word).empty())
-            word_to_document_freqs_.erase(word);
+        idfs_.Remove(terms_.Find(word_freq.word));
     }
+
+    // The postings stay in the segment until it is merged.
+    FindSegment(document).Remove(document);
+    document_to_word_freqs_[document].reset();
+    document_ordinals_.erase(it);
+    document_ids_.erase(document_id);
+    idfs_.SetDocumentCount(document_ordinals_.size());
+    query_cache_.Invalidate();
+    Metrics::Add(MetricCounter::REMOVED_DOCUMENTS);
+
+    StartMergeIfNeeded();
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id)
 {
-    if ((document_id < 0) || (documents_.count(document_id) == 0))
+    METRICS_STAGE(MetricStage::REMOVE_DOCUMENT);
+    std::lock_guard<std::shared_mutex> lock(index_mutex_);
+
+    const auto it = document_ordinals_.find(document_id);
+    if ((document_id < 0) || (it == document_ordinals_.end()))
     {
         throw std::invalid_argument("Invalid document_id");
     }
-    std::set<std::string_view> doc_words;
 
-    auto doc_frequencies = GetWordFrequencies(document_id);
+    const Ordinal document = it->second;
+    const WordFrequencies::Entries& word_freqs = *document_to_word_freqs_[document];
 
-    std::transform(doc_frequencies.begin(), doc_frequencies.end(),
-        std::inserter(doc_words, doc_words.end()), [](auto word) { return word.first; });
+    // Words are looked up concurrently, the frequency table is updated by one thread.
+    std::vector<TermDictionary::TermId> document_terms(word_freqs.size());
+    std::transform(std::execution::par,
+        word_freqs.begin(), word_freqs.end(), document_terms.begin(),
+        [this](const WordFrequency& word_freq) { return terms_.Find(word_freq.word); });
 
-    std::for_each(std::execution::par,
-        doc_words.begin(),
-        doc_words.end(),
-        [this, document_id]
-    (const auto& word)
-        {  this->word_to_document_freqs_.at(std::string{ word }).erase(document_id);
-});
+    for (const TermDictionary::TermId term : document_terms)
+    {
+        idfs_.Remove(term);
+    }
 
-    documents_.erase(document_id);
+    // The postings stay in the segment until it is merged.
+    FindSegment(document).Remove(document);
+    document_to_word_freqs_[document].reset();
+    document_ordinals_.erase(it);
     document_ids_.erase(document_id);
+    idfs_.SetDocumentCount(document_ordinals_.size());
+    query_cache_.Invalidate();
+    Metrics::Add(MetricCounter::REMOVED_DOCUMENTS);
+
+    StartMergeIfNeeded();
 }
 
+void SearchServer::MergeSegments()
+{
+    std::lock_guard<std::mutex> lock(merge_.mutex);
+    while (MergeNextSegments())
+    {
+    }
+}
 
-/*********************************************************
- ***************   Private class members   ***************
- *********************************************************/
+size_t SearchServer::GetSegmentCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    return segments_.size();
+}
 
-bool SearchServer::IsStopWord(const std::string_view word) const
+void SearchServer::SetQueryCacheCapacity(size_t entry_count)
 {
-    return stop_words_.count(std::string{ word }) > 0;
+    query_cache_.SetCapacity(entry_count);
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(std::string_view text) const
+QueryCache::Statistics SearchServer::GetQueryCacheStatistics() const
 {
-    std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(std::string{ text }))
+    return query_cache_.GetStatistics();
+}
+
+
+void SearchServer::SaveSnapshot(const std::string& path) const
+{
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+
+    const std::string temporary_path = path + ".tmp";
     {
-        if (!IsValidWord(word))
+        std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Can not create snapshot file " + temporary_path);
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        BinaryWriter writer(out);
+
+        writer.Write(static_cast<uint64_t>(stop_words_.size()));
+        for (const std::string& stop_word : stop_words_)
+            writer.WriteString(stop_word);
+
+        writer.Write(static_cast<uint64_t>(terms_.size()));
+        for (TermDictionary::TermId term = 0; term < terms_.size(); ++term)
+            writer.WriteString(terms_.GetTerm(term));
+
+        const size_t ordinal_count = documents_.ids.size();
+        std::vector<uint8_t> live_ordinals(ordinal_count, 0);
+        for (const auto [document_id, ordinal] : document_ordinals_)
+            live_ordinals[ordinal] = 1;
+
+        writer.Write(static_cast<uint64_t>(ordinal_count));
+        WriteColumn(writer, documents_.ids);
+        WriteColumn(writer, documents_.ratings);
+        WriteColumn(writer, documents_.statuses);
+        WriteColumn(writer, documents_.inv_word_counts);
+        WriteColumn(writer, live_ordinals);
+        WriteColumn(writer, documents_.fingerprints);
+
+        std::vector<uint32_t> word_counts(ordinal_count, 0);
+        std::vector<TermDictionary::TermId> word_terms;
+        std::vector<double> word_freqs;
+        for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal)
         {
-            throw std::invalid_argument("Word " + word + " is invalid");
+            if (!document_to_word_freqs_[ordinal])
+                continue;
+
+            word_counts[ordinal] = static_cast<uint32_t>(document_to_word_freqs_[ordinal]->size());
+            for (const WordFrequency& word_freq : *document_to_word_freqs_[ordinal])
+            {
+                word_terms.push_back(terms_.Find(word_freq.word));
+                word_freqs.push_back(word_freq.frequency);
+            }
         }
-        if (!IsStopWord(word))
+        WriteColumn(writer, word_counts);
+        writer.Write(static_cast<uint64_t>(word_terms.size()));
+        WriteColumn(writer, word_terms);
+        WriteColumn(writer, word_freqs);
+
+        std::vector<uint32_t> document_freqs(terms_.size());
+        for (TermDictionary::TermId term = 0; term < terms_.size(); ++term)
+            document_freqs[term] = idfs_.GetDocumentFreq(term);
+        WriteColumn(writer, document_freqs);
+
+        writer.Write(static_cast<uint64_t>(segments_.size()));
+        for (const IndexSegment& segment : segments_)
+            segment.Save(writer);
+
+        header.payload_size = static_cast<uint64_t>(out.tellp()) - sizeof(header);
+        header.checksum = writer.GetChecksum();
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        if (!out.flush())
+            throw std::runtime_error("Can not write snapshot file " + temporary_path);
+    }
+
+    std::filesystem::rename(temporary_path, path);
+}
+
+SearchServer SearchServer::LoadSnapshot(const std::string& path)
+{
+    const MappedFile file(path);
+
+    SnapshotHeader header;
+    if (file.size() < sizeof(header))
+        throw std::runtime_error("Snapshot file is too short");
+
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        throw std::runtime_error("File is not a search server snapshot");
+    if (header.version != SNAPSHOT_VERSION)
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+    if (header.payload_size != file.size() - sizeof(header))
+        throw std::runtime_error("Snapshot file is truncated");
+
+    const std::string_view payload = file.GetContents().substr(sizeof(header));
+    if (ComputeChecksum(payload.data(), payload.size()) != header.checksum)
+        throw std::runtime_error("Snapshot checksum mismatch");
+
+    BinaryReader reader(payload);
+
+    std::vector<std::string_view> stop_words(reader.Read<uint64_t>());
+    for (std::string_view& stop_word : stop_words)
+        stop_word = reader.ReadString();
+
+    SearchServer search_server(stop_words);
+
+    const uint64_t term_count = reader.Read<uint64_t>();
+    for (uint64_t term = 0; term < term_count; ++term)
+    {
+        if (search_server.terms_.Intern(reader.ReadString()) != term)
+            throw std::runtime_error("Duplicate term in snapshot");
+    }
+
+    const uint64_t ordinal_count = reader.Read<uint64_t>();
+    if (ordinal_count > std::numeric_limits<Ordinal>::max())
+        throw std::runtime_error("Invalid document count in snapshot");
+
+    DocumentData& documents = search_server.documents_;
+    std::vector<uint8_t> live_ordinals;
+    ReadColumn(reader, documents.ids, ordinal_count);
+    ReadColumn(reader, documents.ratings, ordinal_count);
+    ReadColumn(reader, documents.statuses, ordinal_count);
+    ReadColumn(reader, documents.inv_word_counts, ordinal_count);
+    ReadColumn(reader, live_ordinals, ordinal_count);
+
+    for (Ordinal ordinal = 0; ordinal < ordinal_count; ++ordinal)
+    {
+        if (live_ordinals[ordinal] == 0)
+            continue;
+
+        if (!search_server.document_ordinals_.emplace(documents.ids[ordinal], ordinal).second)
+            throw std::runtime_error("Duplicate document id in snapshot");
+        search_server.document_ids_.insert(documents.ids[ordinal]);
+    }
+
+    // The forward index, the fingerprints and the document frequencies are stored,
+    // so the postings are not walked to restore them.
+    ReadColumn(reader, documents.fingerprints, ordinal_count);
+
+    std::vector<uint32_t> word_counts;
+    std::vector<TermDictionary::TermId> word_terms;
+    std::vector<double> word_freqs;
+    ReadColumn(reader, word_counts, ordinal_count);
+    const uint64_t word_count = reader.Read<uint64_t>();
+    ReadColumn(reader, word_terms, word_count);
+    ReadColumn(reader, word_freqs, word_count);
+
+    search_server.document_to_word_freqs_.resize(ordinal_count);
+    uint64_t first_word = 0;
+    for (Ordinal ordinal = 0; ordinal < ordinal_count; ++ordinal)
+    {
+        if (((live_ordinals[ordinal] == 0) && (word_counts[ordinal] != 0)) || (word_count - first_word < word_counts[ordinal]))
+            throw std::runtime_error("Invalid forward index in snapshot");
+        if (live_ordinals[ordinal] == 0)
+            continue;
+
+        WordFrequencies::Entries entries(word_counts[ordinal]);
+        for (WordFrequency& entry : entries)
+        {
+            if (word_terms[first_word] >= term_count)
+                throw std::runtime_error("Invalid forward index in snapshot");
+            entry = { search_server.terms_.GetTerm(word_terms[first_word]), word_freqs[first_word] };
+            ++first_word;
+        }
+        search_server.document_to_word_freqs_[ordinal] = WordFrequencies::MakeEntries(std::move(entries));
+    }
+    if (first_word != word_count)
+        throw std::runtime_error("Invalid forward index in snapshot");
+
+    std::vector<uint32_t> document_freqs;
+    ReadColumn(reader, document_freqs, term_count);
+    search_server.idfs_.Resize(term_count);
+    search_server.idfs_.SetDocumentCount(search_server.document_ordinals_.size());
+    for (TermDictionary::TermId term = 0; term < term_count; ++term)
+    {
+        if (document_freqs[term] > search_server.document_ordinals_.size())
+            throw std::runtime_error("Invalid document frequency in snapshot");
+        if (document_freqs[term] > 0)
+            search_server.idfs_.Add(term, document_freqs[term]);
+    }
+
+    const uint64_t segment_count = reader.Read<uint64_t>();
+    if ((segment_count == 0) || (segment_count > ordinal_count + 1))
+        throw std::runtime_error("Invalid segment count in snapshot");
+
+    search_server.segments_.clear();
+    for (uint64_t i = 0; i < segment_count; ++i)
+    {
+        const IndexSegment& segment = search_server.segments_.emplace_back(IndexSegment::Load(reader, live_ordinals, term_count));
+        if ((i > 0) && (search_server.segments_[i - 1].GetEndDocument() > segment.GetFirstDocument()))
+            throw std::runtime_error("Overlapping segments in snapshot");
+    }
+
+    // New documents are appended to the last segment.
+    if (search_server.segments_.back().GetEndDocument() != ordinal_count)
+        throw std::runtime_error("Invalid last segment in snapshot");
+
+    // Live documents must be covered by the segments.
+    Ordinal covered_ordinals = 0;
+    for (const IndexSegment& segment : search_server.segments_)
+        covered_ordinals += static_cast<Ordinal>(segment.GetLiveCount());
+    if (covered_ordinals != search_server.document_ordinals_.size())
+        throw std::runtime_error("Document outside of segments in snapshot");
+
+    if (!reader.IsEnd())
+        throw std::runtime_error("Unexpected data at the end of snapshot");
+
+    return search_server;
+}
+
+
+/*********************************************************
+ ***************   Private class members   ***************
+ *********************************************************/
+
+template <typename ExecutionPolicy>
+void SearchServer::AddDocumentBatch(const ExecutionPolicy& policy, const std::vector<DocumentInput>& documents)
+{
+    METRICS_STAGE(MetricStage::ADD_DOCUMENTS);
+
+    const auto validate_ids = [this, &documents]()
+    {
+        std::unordered_set<int> batch_ids;
+        for (const DocumentInput& document : documents)
         {
-            words.push_back(word);
+            if ((document.id < 0) || (document_ordinals_.count(document.id) > 0) || !batch_ids.insert(document.id).second)
+            {
+                throw std::invalid_argument("Invalid document_id");
+            }
         }
+    };
+
+    {
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+        validate_ids();
+    }
+
+    // Steps 1 and 2 do not read the index, queries run meanwhile.
+
+    // 1. Tokenization and TF calculation, every document separately.
+    struct TokenizedDocument
+    {
+        std::vector<std::pair<std::string_view, uint32_t>> word_counts;
+        double inv_word_count = 0.0;
+        std::exception_ptr error;
+    };
+
+    std::vector<TokenizedDocument> tokenized_documents(documents.size());
+    std::transform(policy, documents.begin(), documents.end(), tokenized_documents.begin(),
+        [this](const DocumentInput& document)
+        {
+            TokenizedDocument tokenized_document;
+            try
+            {
+                std::vector<std::string_view> words = SplitIntoWordsNoStop(document.text);
+                tokenized_document.inv_word_count = 1.0 / words.size();
+
+                std::sort(words.begin(), words.end());
+                for (const std::string_view word : words)
+                {
+                    if (tokenized_document.word_counts.empty() || (tokenized_document.word_counts.back().first != word))
+                        tokenized_document.word_counts.emplace_back(word, 0);
+                    ++tokenized_document.word_counts.back().second;
+                }
+            }
+            catch (...)
+            {
+                // An exception must not leave a task of a parallel algorithm.
+                tokenized_document.error = std::current_exception();
+            }
+            return tokenized_document;
+        });
+
+    for (const TokenizedDocument& tokenized_document : tokenized_documents)
+    {
+        if (tokenized_document.error)
+            std::rethrow_exception(tokenized_document.error);
+    }
+
+    // 2. Partial inverted indexes of consecutive documents.
+    //    Postings refer to the position of a document in the batch
+    //    until its ordinal is known.
+    struct PartialIndex
+    {
+        size_t first;
+        size_t last;
+        std::unordered_map<std::string_view, std::vector<PostingList::Posting>> word_postings;
+        std::vector<std::pair<TermDictionary::TermId, const std::vector<PostingList::Posting>*>> term_postings;
+    };
+
+    std::vector<PartialIndex> partial_indexes;
+    for (size_t first = 0; first < documents.size(); first += INGEST_CHUNK_SIZE)
+    {
+        partial_indexes.push_back({ first, std::min(first + INGEST_CHUNK_SIZE, documents.size()), {}, {} });
+    }
+
+    std::for_each(policy, partial_indexes.begin(), partial_indexes.end(),
+        [&tokenized_documents](PartialIndex& partial_index)
+        {
+            for (size_t i = partial_index.first; i < partial_index.last; ++i)
+            {
+                for (const auto& [word, count] : tokenized_documents[i].word_counts)
+                {
+                    partial_index.word_postings[word].push_back({ static_cast<Ordinal>(i), count });
+                }
+            }
+        });
+
+    // Additions are applied one at a time: while this one holds update_mutex_, the dictionary,
+    // the ordinals and the document ids are changed by nobody else, so they are read without
+    // index_mutex_ and queries are blocked only to intern new words and to publish the batch.
+    std::lock_guard<std::shared_mutex> update_lock(update_mutex_);
+
+    // Another update may have added one of the documents while this batch was being prepared.
+    Ordinal first_ordinal = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+        validate_ids();
+        first_ordinal = static_cast<Ordinal>(documents_.ids.size());
+    }
+
+    // 3. Term ids of the batch words. Known words are looked up concurrently,
+    //    the dictionary is not thread-safe, so new words are interned by one thread.
+    std::vector<std::vector<std::string_view>> partial_new_words(partial_indexes.size());
+    std::vector<size_t> partial_numbers(partial_indexes.size());
+    std::iota(partial_numbers.begin(), partial_numbers.end(), 0);
+    std::for_each(policy, partial_numbers.begin(), partial_numbers.end(),
+        [this, &partial_indexes, &partial_new_words](size_t i)
+        {
+            for (const auto& [word, _] : partial_indexes[i].word_postings)
+            {
+                if (terms_.Find(word) == TermDictionary::NO_TERM)
+                    partial_new_words[i].push_back(word);
+            }
+        });
+
+    std::unordered_set<std::string_view> new_words;
+    for (const std::vector<std::string_view>& words : partial_new_words)
+        new_words.insert(words.begin(), words.end());
+
+    if (!new_words.empty())
+    {
+        // New terms have df 0 until the batch is published, so queries skip them.
+        std::lock_guard<std::shared_mutex> lock(index_mutex_);
+        for (const std::string_view word : new_words)
+            terms_.Intern(word);
+        idfs_.Resize(terms_.size());
+    }
+
+    std::for_each(policy, partial_indexes.begin(), partial_indexes.end(),
+        [this](PartialIndex& partial_index)
+        {
+            partial_index.term_postings.reserve(partial_index.word_postings.size());
+            for (const auto& [word, postings] : partial_index.word_postings)
+            {
+                partial_index.term_postings.emplace_back(terms_.Find(word), &postings);
+            }
+            std::sort(partial_index.term_postings.begin(), partial_index.term_postings.end(),
+                [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+        });
+
+    // 4. Merge into a segment of the batch sorted by term, then by document: every task owns
+    //    a range of the batch terms and appends the postings of the partial indexes
+    //    in the order of ordinals. The segment is not seen by queries until it is published.
+    IndexSegment batch_segment(first_ordinal);
+    batch_segment.Extend(static_cast<Ordinal>(first_ordinal + documents.size()));
+
+    // Posting lists are created by one thread, then filled concurrently.
+    std::vector<std::pair<TermDictionary::TermId, PostingList*>> batch_terms;
+    for (const PartialIndex& partial_index : partial_indexes)
+    {
+        for (const auto& [term, _] : partial_index.term_postings)
+            batch_terms.emplace_back(term, nullptr);
+    }
+    std::sort(batch_terms.begin(), batch_terms.end());
+    batch_terms.erase(std::unique(batch_terms.begin(), batch_terms.end()), batch_terms.end());
+    for (auto& [term, postings] : batch_terms)
+    {
+        postings = &batch_segment.GetPostings(term);
+    }
+
+    const size_t terms_per_task = std::max<size_t>(1, (batch_terms.size() + INGEST_MERGE_TASK_COUNT - 1) / INGEST_MERGE_TASK_COUNT);
+    std::vector<size_t> merge_tasks((batch_terms.size() + terms_per_task - 1) / terms_per_task);
+    std::iota(merge_tasks.begin(), merge_tasks.end(), 0);
+
+    std::vector<uint32_t> batch_document_freqs(batch_terms.size(), 0);
+    std::for_each(policy, merge_tasks.begin(), merge_tasks.end(),
+        [&partial_indexes, &tokenized_documents, &batch_terms, &batch_document_freqs, terms_per_task, first_ordinal](size_t task)
+        {
+            const size_t first = task * terms_per_task;
+            const size_t last = std::min(first + terms_per_task, batch_terms.size());
+            const TermDictionary::TermId first_term = batch_terms[first].first;
+            const TermDictionary::TermId last_term = (last < batch_terms.size()) ? batch_terms[last].first : TermDictionary::NO_TERM;
+
+            for (const PartialIndex& partial_index : partial_indexes)
+            {
+                auto it = std::lower_bound(partial_index.term_postings.begin(), partial_index.term_postings.end(), first_term,
+                    [](const auto& term_postings, TermDictionary::TermId term) { return term_postings.first < term; });
+
+                // Every term of a partial index is among the batch terms.
+                auto target = batch_terms.begin() + first;
+                for (; (it != partial_index.term_postings.end()) && (it->first < last_term); ++it)
+                {
+                    while (target->first < it->first)
+                        ++target;
+
+                    for (const auto [position, count] : *it->second)
+                    {
+                        target->second->Append(first_ordinal + position, count,
+                            count * tokenized_documents[position].inv_word_count);
+                    }
+                    batch_document_freqs[target - batch_terms.begin()] += static_cast<uint32_t>(it->second->size());
+                }
+            }
+        });
+
+    // 5. Forward index entries of the batch. Words of the dictionary stay in place, so the
+    //    entries may point at them before the batch is published.
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::vector<std::shared_ptr<const WordFrequencies::Entries>> batch_word_freqs(documents.size());
+    std::vector<uint64_t> fingerprints(documents.size(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(),
+        [this, &tokenized_documents, &batch_word_freqs, &fingerprints](size_t i)
+        {
+            const TokenizedDocument& tokenized_document = tokenized_documents[i];
+            WordFrequencies::Entries word_freqs;
+            word_freqs.reserve(tokenized_document.word_counts.size());
+            for (const auto& [word, count] : tokenized_document.word_counts)
+            {
+                word_freqs.push_back({ terms_.GetTerm(terms_.Find(word)), count * tokenized_document.inv_word_count });
+                fingerprints[i] += HashWord(word);
+            }
+            batch_word_freqs[i] = WordFrequencies::MakeEntries(std::move(word_freqs));
+        });
+
+    // 6. Publication: the exclusive section only moves the prepared data into the index.
+    std::lock_guard<std::shared_mutex> lock(index_mutex_);
+
+    for (size_t i = 0; i < batch_terms.size(); ++i)
+    {
+        idfs_.Add(batch_terms[i].first, batch_document_freqs[i]);
     }
+
+    // The batch segment becomes the tail, a non-empty tail is sealed before it as it is.
+    if (segments_.back().GetEndDocument() == segments_.back().GetFirstDocument())
+        segments_.back() = std::move(batch_segment);
+    else
+        segments_.push_back(std::move(batch_segment));
+
+    document_to_word_freqs_.insert(document_to_word_freqs_.end(),
+        std::make_move_iterator(batch_word_freqs.begin()), std::make_move_iterator(batch_word_freqs.end()));
+
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        const DocumentInput& document = documents[i];
+        documents_.ids.push_back(document.id);
+        documents_.ratings.push_back(ComputeAverageRating(document.ratings));
+        documents_.statuses.push_back(document.status);
+        documents_.inv_word_counts.push_back(tokenized_documents[i].inv_word_count);
+        documents_.fingerprints.push_back(fingerprints[i]);
+        document_ordinals_.emplace(document.id, first_ordinal + static_cast<Ordinal>(i));
+        document_ids_.insert(document.id);
+    }
+    idfs_.SetDocumentCount(document_ordinals_.size());
+    query_cache_.Invalidate();
+    Metrics::Add(MetricCounter::ADDED_DOCUMENTS, documents.size());
+
+    SealTailSegment();
+    StartMergeIfNeeded();
+}
+
+bool SearchServer::IsStopWord(const std::string_view word) const
+{
+    return stop_words_.count(word) > 0;
+}
+
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const
+{
+    std::vector<std::string_view> words;
+    ForEachWord(text, [this, &words](const std::string_view word)
+        {
+            if (!IsStopWord(word))
+            {
+                words.push_back(word);
+            }
+        });
     return words;
 }
 
@@ -258,42 +953,311 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word) cons
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word))
+    if (word.empty() || word[0] == '-')
     {
-        throw std::invalid_argument("");
+        throw std::invalid_argument("Query word " + std::string{ word } + " is invalid");
     }
 
     return { word, is_minus, IsStopWord(word) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const
+SearchServer::Query SearchServer::ParseQuery(const std::string_view text, QueryProfile* profile) const
 {
-    Query result;
+    StageTimer parse_timer(MetricStage::QUERY_PARSE, QueryProfile::GetStageTimeTarget(profile, MetricStage::QUERY_PARSE));
 
-    for (auto& word : SplitIntoWordsView(text))
-    {
-        const auto query_word = ParseQueryWord(word);
+    Query result;
 
-        if (!query_word.is_stop)
+    ForEachWord(text, [this, &result, profile](const std::string_view word)
         {
-            if (query_word.is_minus)
+            const auto query_word = ParseQueryWord(word);
+
+            if (query_word.is_stop)
             {
-                result.minus_words.insert(query_word.data);
+                if (profile)
+                    profile->stop_words.emplace_back(query_word.data);
             }
             else
             {
-                result.plus_words.insert(query_word.data);
+                if (query_word.is_minus)
+                {
+                    result.minus_words.insert(query_word.data);
+                }
+                else
+                {
+                    result.plus_words.insert(query_word.data);
+                }
             }
+        });
+    return result;
+}
+
+std::string SearchServer::MakeQueryKey(const Query& query, const DocumentFilter& filter, size_t top_count)
+{
+    std::string key;
+    for (const std::string_view word : query.plus_words)
+    {
+        key += '+';
+        key += word;
+        key += ' ';
+    }
+    for (const std::string_view word : query.minus_words)
+    {
+        key += '-';
+        key += word;
+        key += ' ';
+    }
+
+    // Words contain no spaces, so the numbers can not be confused with them.
+    for (const int64_t value : { int64_t{ filter.statuses }, int64_t{ filter.min_rating }, int64_t{ filter.max_rating },
+                                 int64_t{ filter.min_id }, int64_t{ filter.max_id }, static_cast<int64_t>(top_count) })
+    {
+        key += ' ';
+        key += std::to_string(value);
+    }
+    return key;
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(TermDictionary::TermId term) const
+{
+    return idfs_.GetInverseDocumentFreq(term);
+}
+
+std::vector<std::pair<TermDictionary::TermId, double>> SearchServer::FindQueryTerms(
+    const std::set<std::string_view, std::less<>>& words, bool with_idf) const
+{
+    std::vector<std::pair<TermDictionary::TermId, double>> terms;
+
+    for (const std::string_view word : words)
+    {
+        const TermDictionary::TermId term = terms_.Find(word);
+        if ((term == TermDictionary::NO_TERM) || (idfs_.GetDocumentFreq(term) == 0))
+            continue;
+
+        terms.emplace_back(term, with_idf ? ComputeWordInverseDocumentFreq(term) : 0.0);
+    }
+
+    return terms;
+}
+
+OrdinalBitmap SearchServer::FindExcludedDocuments(const std::set<std::string_view, std::less<>>& words, QueryProfile* profile) const
+{
+    StageTimer exclusion_timer(MetricStage::MINUS_EXCLUSION, QueryProfile::GetStageTimeTarget(profile, MetricStage::MINUS_EXCLUSION));
+
+    if (profile)
+        profile->minus_terms = ProfileTerms(words, false);
+
+    OrdinalBitmap excluded_documents;
+
+    for (const auto& term : FindQueryTerms(words, false))
+    {
+        for (const IndexSegment& segment : segments_)
+        {
+            const PostingList* postings = segment.FindPostings(term.first);
+            if (postings == nullptr)
+                continue;
+
+            for (const auto [document, _] : *postings)
+                excluded_documents.Insert(document);
         }
     }
-    return result;
+
+    return excluded_documents;
+}
+
+std::vector<QueryProfile::Term> SearchServer::ProfileTerms(const std::set<std::string_view, std::less<>>& words,
+    bool with_idf) const
+{
+    std::vector<QueryProfile::Term> terms;
+
+    for (const std::string_view word : words)
+    {
+        QueryProfile::Term& profile_term = terms.emplace_back();
+        profile_term.word = std::string(word);
+
+        const TermDictionary::TermId term = terms_.Find(word);
+        if ((term == TermDictionary::NO_TERM) || (idfs_.GetDocumentFreq(term) == 0))
+            continue;
+
+        for (const IndexSegment& segment : segments_)
+        {
+            if (const PostingList* postings = segment.FindPostings(term))
+                profile_term.posting_count += postings->size();
+        }
+        if (with_idf)
+            profile_term.inverse_document_freq = ComputeWordInverseDocumentFreq(term);
+    }
+
+    return terms;
+}
+
+std::vector<SearchServer::TermCursor> SearchServer::MakeTermCursors(const IndexSegment& segment,
+    const std::vector<std::pair<TermDictionary::TermId, double>>& terms)
+{
+    std::vector<TermCursor> cursors;
+
+    for (const auto& [term, inverse_document_freq] : terms)
+    {
+        const PostingList* postings = segment.FindPostings(term);
+        if (postings != nullptr)
+            cursors.push_back({ postings->begin(), postings, inverse_document_freq, postings->GetMaxTermFreq() * inverse_document_freq });
+    }
+
+    return cursors;
+}
+
+std::vector<SearchServer::PostingChunk> SearchServer::SplitIntoPostingChunks(
+    const std::set<std::string_view, std::less<>>& words) const
+{
+    std::vector<PostingChunk> chunks;
+
+    for (const auto& [term, inverse_document_freq] : FindQueryTerms(words, true))
+    {
+        for (const IndexSegment& segment : segments_)
+        {
+            const PostingList* postings = segment.FindPostings(term);
+            if (postings == nullptr)
+                continue;
+
+            const size_t block_count = postings->GetBlockCount();
+            for (size_t first_block = 0; first_block < block_count; first_block += POSTING_CHUNK_BLOCKS)
+            {
+                chunks.push_back({ &segment, postings, first_block, std::min(first_block + POSTING_CHUNK_BLOCKS, block_count),
+                                   inverse_document_freq });
+            }
+        }
+    }
+
+    return chunks;
+}
+
+IndexSegment& SearchServer::FindSegment(Ordinal document)
+{
+    return *std::partition_point(segments_.begin(), segments_.end(),
+        [document](const IndexSegment& segment) { return segment.GetEndDocument() <= document; });
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const
+const IndexSegment& SearchServer::FindSegment(Ordinal document) const
 {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(std::string{ word }).size());
+    return *std::partition_point(segments_.begin(), segments_.end(),
+        [document](const IndexSegment& segment) { return segment.GetEndDocument() <= document; });
 }
 
+void SearchServer::SealTailSegment()
+{
+    if (segments_.back().GetEndDocument() - segments_.back().GetFirstDocument() < SEGMENT_FLUSH_DOCUMENTS)
+        return;
+
+    segments_.emplace_back(segments_.back().GetEndDocument());
+    StartMergeIfNeeded();
+}
+
+void SearchServer::StartMergeIfNeeded()
+{
+    // A change that comes while a merge is finishing is picked up by the next merge.
+    const auto [first, last] = SelectSegmentsToMerge();
+    if ((first != last) && !merge_.IsRunning())
+    {
+        merge_.task = std::async(std::launch::async, [this]() { MergeSegments(); });
+    }
+}
+
+std::pair<size_t, size_t> SearchServer::SelectSegmentsToMerge() const
+{
+    const size_t sealed_count = segments_.size() - 1;
+
+    for (size_t i = 0; i < sealed_count; ++i)
+    {
+        const IndexSegment& segment = segments_[i];
+        if (segment.GetRemovedCount() > (segment.GetLiveCount() + segment.GetRemovedCount()) * SEGMENT_MAX_REMOVED_SHARE)
+            return { i, i + 1 };
+    }
+
+    // Size tier of a segment: every tier holds SEGMENT_MERGE_FACTOR times more documents.
+    const auto get_tier = [](const IndexSegment& segment)
+    {
+        size_t tier = 0;
+        for (size_t size = SEGMENT_FLUSH_DOCUMENTS * SEGMENT_MERGE_FACTOR; size <= segment.GetLiveCount(); size *= SEGMENT_MERGE_FACTOR)
+            ++tier;
+        return tier;
+    };
+
+    for (size_t first = 0; first + SEGMENT_MERGE_FACTOR <= sealed_count; ++first)
+    {
+        const size_t tier = get_tier(segments_[first]);
+        const auto last = std::find_if(segments_.begin() + first + 1, segments_.begin() + first + SEGMENT_MERGE_FACTOR,
+            [&get_tier, tier](const IndexSegment& segment) { return get_tier(segment) != tier; });
+
+        if (last == segments_.begin() + first + SEGMENT_MERGE_FACTOR)
+            return { first, first + SEGMENT_MERGE_FACTOR };
+    }
+
+    return { 0, 0 };
+}
+
+bool SearchServer::MergeNextSegments()
+{
+    // 1. Choice of the segments and a copy of their tombstones.
+    std::vector<const IndexSegment*> sources;
+    std::vector<bool> tombstones;
+    std::vector<double> inv_word_counts;
+    {
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+
+        const auto [first, last] = SelectSegmentsToMerge();
+        if (first == last)
+            return false;
+
+        const Ordinal first_document = segments_[first].GetFirstDocument();
+        const Ordinal end_document = segments_[last - 1].GetEndDocument();
+        tombstones.assign(end_document - first_document, true);
+        inv_word_counts.assign(documents_.inv_word_counts.begin() + first_document,
+                               documents_.inv_word_counts.begin() + end_document);
+        for (size_t i = first; i < last; ++i)
+        {
+            const IndexSegment& segment = segments_[i];
+            sources.push_back(&segment);
+            for (Ordinal document = segment.GetFirstDocument(); document < segment.GetEndDocument(); ++document)
+            {
+                tombstones[document - first_document] = segment.IsRemoved(document);
+            }
+        }
+    }
+
+    // 2. Sealed segments are not changed except for tombstones, so they are read without the lock.
+    IndexSegment merged = IndexSegment::Merge(sources, tombstones, inv_word_counts);
+
+    // 3. Replacement of the sources, documents removed meanwhile are removed from the result.
+    std::lock_guard<std::shared_mutex> lock(index_mutex_);
+
+    const Ordinal first_document = sources.front()->GetFirstDocument();
+    for (const IndexSegment* segment : sources)
+    {
+        for (Ordinal document = segment->GetFirstDocument(); document < segment->GetEndDocument(); ++document)
+        {
+            if (segment->IsRemoved(document) && !tombstones[document - first_document])
+                merged.Remove(document);
+        }
+    }
+
+    const auto first = std::find_if(segments_.begin(), segments_.end(),
+        [&sources](const IndexSegment& segment) { return &segment == sources.front(); });
+    const auto last = segments_.erase(first, first + sources.size());
+
+    // A segment without live documents is dropped, its ordinals are never looked up again.
+    if (merged.GetLiveCount() > 0)
+        segments_.insert(last, std::move(merged));
+
+    return true;
+}
+
+SearchServer::Ordinal SearchServer::GetOrdinal(int document_id) const
+{
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end())
+        throw std::out_of_range("non-existing document_id");
+
+    return it->second;
+}
 
 /*********************************************************
  ************   Functions outside the class   ************
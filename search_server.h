@@ -4,9 +4,23 @@
 #include "string_processing.h"
 #include "concurrent_map.h"
 #include "log_duration.h"
+#include "metrics.h"
+#include "query_profile.h"
+#include "term_dictionary.h"
+#include "posting_list.h"
+#include "index_segment.h"
+#include "idf_table.h"
+#include "ordinal_bitmap.h"
+#include "top_documents.h"
+#include "query_cache.h"
+#include "query_control.h"
+#include "word_hash.h"
+#include "word_frequencies.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <vector>
+#include <deque>
 #include <string>
 #include <map>
 #include <set>
@@ -16,10 +30,49 @@
 #include <functional>
 #include <type_traits>
 #include <future>
-
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-
-
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <limits>
+
+const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+
+// Maximum count of posting blocks scored by one task of the parallel search.
+const size_t POSTING_CHUNK_BLOCKS = 16;
+
+// Count of candidate documents or postings scored between checks of the query control.
+const size_t QUERY_CONTROL_CHECK_INTERVAL = 1024;
+
+// Count of independently locked buckets of the parallel relevance accumulator.
+const size_t RELEVANCE_BUCKET_COUNT = 256;
+
+// Count of documents after which the mutable index segment is sealed.
+const size_t SEGMENT_FLUSH_DOCUMENTS = 4096;
+
+// Count of adjacent sealed segments of one size tier that are merged together.
+const size_t SEGMENT_MERGE_FACTOR = 4;
+
+// Share of removed documents after which a sealed segment is rewritten.
+const double SEGMENT_MAX_REMOVED_SHARE = 0.25;
+
+
+/* Queries (FindTopDocuments, MatchDocument, GetWordFrequencies) may run
+ * concurrently with each other and with AddDocument, AddDocuments and
+ * RemoveDocument. Additions are applied one at a time: they tokenize, look up
+ * terms and build the segment of a batch without blocking queries, and lock
+ * the index exclusively only to intern new words and to publish the result.
+ * Iteration over document ids must not overlap with updates.
+ *
+ * The inverted index is split into segments of consecutive documents: sealed
+ * segments are never appended to, new documents go to the last, mutable one.
+ * Removal only marks the document in its segment. Sealed segments are merged
+ * in the background, which drops the postings of removed documents.
+ *
+ * Results of queries filtered by status or DocumentFilter may be cached,
+ * any change of the documents invalidates the cache.
+ *
+ * Stages of queries and updates are timed and counted by Metrics. */
 class SearchServer
 {
 public:
@@ -30,9 +83,18 @@ public:
 
     explicit SearchServer(const std::string& stop_words_text);
 
-    inline int GetDocumentCount() const noexcept
+    /* Copying or moving waits for the background merge of the source.
+     * A copy gets its own term dictionary, its forward index points at the copied words. */
+    SearchServer(const SearchServer& other);
+
+    SearchServer(SearchServer&&) = default;
+
+    ~SearchServer();
+
+    inline int GetDocumentCount() const
     {
-        return documents_.size();
+        std::shared_lock<std::shared_mutex> lock(index_mutex_);
+        return static_cast<int>(document_ordinals_.size());
     }
 
     inline auto begin() const
@@ -55,26 +117,72 @@ public:
                      DocumentStatus status,
                      const std::vector<int>& ratings);
 
+    /* @brief Bulk addition of documents.
+     *        Documents are tokenized in parallel, every task builds a partial
+     *        inverted index of its documents, then the partial indexes are merged
+     *        into a new segment in one pass sorted by term and document.
+     *        Queries are blocked only while new words are interned and the segment
+     *        and the documents are published.
+     *        Nothing is added if any document is invalid.
+     * @param documents - documents to add. */
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+
+    void AddDocuments(const std::execution::sequenced_policy&, const std::vector<DocumentInput>& documents);
+
+    void AddDocuments(const std::execution::parallel_policy&, const std::vector<DocumentInput>& documents);
+
     /* @brief Search method and compilation of the top documents on query.
      * @param query - custom document search query.
      * @param document_predicate - custom sort predicate.
+     * @param top_count - maximum count of documents in the result.
      * @return Vector top documents ranked by rating. */
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query,
-        DocumentPredicate document_predicate) const;
+        DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+    /* @brief FindTopDocuments with an execution trace of the query.
+     *        The result cache is bypassed, so the trace shows the work of the search.
+     * @return Top documents and the trace of the query. */
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::pair<std::vector<Document>, QueryProfile> ExplainTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query,
+        DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::pair<std::vector<Document>, QueryProfile> ExplainTopDocuments(const std::string_view raw_query) const;
+
+    /* @brief Asynchronous search, the query is a task of ThreadPool::GetDefault().
+     *        The server must not be destroyed or moved until the future is ready.
+     * @param raw_query - custom document search query.
+     * @param filter - filter of documents, actual documents by default.
+     * @param top_count - maximum count of documents in the result.
+     * @param control - cancellation and deadline of the query.
+     * @return Future of the top documents. It holds QueryCancelledError or
+     *         QueryDeadlineError if the query is stopped. */
+    std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query,
+        DocumentFilter filter = DocumentFilter::ForStatus(DocumentStatus::ACTUAL),
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT, QueryControl control = {}) const;
+
+    /* @brief Asynchronous search by a batch of queries, every query is a separate task.
+     *        One control stops all queries of the batch.
+     * @return Futures of the top documents, in the order of the queries. */
+    std::vector<std::future<std::vector<Document>>> FindTopDocumentsAsync(const std::vector<std::string>& raw_queries,
+        DocumentFilter filter = DocumentFilter::ForStatus(DocumentStatus::ACTUAL),
+        size_t top_count = MAX_RESULT_DOCUMENT_COUNT, QueryControl control = {}) const;
     
     /* @brief A method that checks which query words are contained in the document.
      *        If the document contains minus words, then the return value will be empty.
@@ -93,8 +201,17 @@ public:
 
     /* @brief Method for obtaining word frequency by document id.
      * @param document_id - id of the document in which word frequency is checked.
-     * @return Words and their frequency in the document. */
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+     * @return Words and their frequency in the document, empty if there is no document.
+     *         The view shares the forward index and stays valid after the document is removed. */
+    WordFrequencies GetWordFrequencies(int document_id) const;
+
+    /* @brief Fingerprint of the set of words of a document, computed when the document is added.
+     *        Documents with the same words have the same fingerprint regardless of word
+     *        order and counts. Different sets rarely collide, so equal fingerprints
+     *        must be confirmed by the words when exactness matters.
+     * @param document_id - id of the document.
+     * @throw std::out_of_range if the document does not exist. */
+    uint64_t GetDocumentFingerprint(int document_id) const;
 
     /* @brief Method for removing documents from a search server.
      * @param document_id - id of the deleted document. */
@@ -104,11 +221,103 @@ public:
 
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
+    /* @brief Merging of the sealed index segments chosen by the merge policy,
+     *        until no segment needs merging. Merged segments are built without
+     *        blocking queries and updates. The server runs it in the background
+     *        after sealing a segment, an explicit call compacts the index at once. */
+    void MergeSegments();
+
+    size_t GetSegmentCount() const;
+
+    /* @brief Enabling of the query result cache.
+     *        Queries are cached by their words, DocumentFilter and top count,
+     *        queries with a custom predicate are never cached.
+     * @param entry_count - maximum count of cached results, 0 disables the cache. */
+    void SetQueryCacheCapacity(size_t entry_count);
+
+    QueryCache::Statistics GetQueryCacheStatistics() const;
+
+    /* @brief Saving the index to a binary snapshot file.
+     *        The file is versioned and checksummed, it is written to a temporary
+     *        file first and then renamed, so a failed save keeps the old snapshot.
+     * @param path - snapshot file path.
+     * @throw std::runtime_error if the file can not be written. */
+    void SaveSnapshot(const std::string& path) const;
+
+    /* @brief Loading a server from a snapshot made by SaveSnapshot.
+     *        The file is memory-mapped, the encoded posting lists are checked block
+     *        by block and taken as they are, the forward index and document frequencies
+     *        are read from their columns, documents are not tokenized again.
+     * @param path - snapshot file path.
+     * @return Server with the same stop words and documents.
+     * @throw std::runtime_error if the file is missing, corrupted or has another version. */
+    static SearchServer LoadSnapshot(const std::string& path);
+
 private:
+    /* Shared mutex of the index. A copied or moved server gets its own
+     * unlocked mutex, so the server stays copyable and movable. */
+    struct IndexMutex : std::shared_mutex
+    {
+        IndexMutex() = default;
+
+        IndexMutex(const IndexMutex&)
+            : std::shared_mutex()
+        {
+        }
+
+        IndexMutex& operator=(const IndexMutex&)
+        {
+            return *this;
+        }
+    };
+
+    /* Background merge of segments. A copied or moved server waits
+     * for the merge of the source and starts without one. */
+    struct MergeState
+    {
+        // Only one merge runs at a time.
+        std::mutex mutex;
+        std::future<void> task;
+
+        MergeState() = default;
+
+        MergeState(const MergeState& other)
+        {
+            other.Wait();
+        }
+
+        MergeState& operator=(const MergeState& other)
+        {
+            other.Wait();
+            return *this;
+        }
+
+        void Wait() const
+        {
+            if (task.valid())
+                task.wait();
+        }
+
+        bool IsRunning() const
+        {
+            return task.valid() && (task.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+        }
+    };
+
+    /* Internal dense number of a document. Ordinals are handed out
+     * in the order of addition and are never reused after removal. */
+    using Ordinal = PostingList::Ordinal;
+
+    /* Metadata of documents as struct-of-arrays indexed by ordinal. */
     struct DocumentData
     {
-        int rating;
-        DocumentStatus status;
+        std::vector<int> ids;
+        std::vector<int> ratings;
+        std::vector<DocumentStatus> statuses;
+        // TF of a word is its count in the document multiplied by this value.
+        std::vector<double> inv_word_counts;
+        // Sum of HashWord of the unique words of the document.
+        std::vector<uint64_t> fingerprints;
     };
 
     struct QueryWord
@@ -124,19 +333,47 @@ private:
         std::set<std::string_view, std::less<>> minus_words;
     };
 
+    // Declared first, so that a copy waits for the merge before copying the index.
+    MergeState merge_;
+
+    // Queries hold it shared, updates hold it exclusively.
+    mutable IndexMutex index_mutex_;
+
+    // Held by additions from the assignment of term ids to publication, so that a batch
+    // prepared outside index_mutex_ sees no other change of the dictionary and ordinals.
+    IndexMutex update_mutex_;
+
     std::set<int> document_ids_;
     const std::set<std::string, std::less<>> stop_words_;
-    std::map<int, std::map<std::string, double, std::less<>>> document_to_word_freqs_;
 
-    /* @param std::string - word from document;
-     * @param std::map<int, double>]:
-     *        @param int - document id;
-     *        @param double - word frequency in the document; */
-    std::map<std::string, std::map<int, double>, std::less<>> word_to_document_freqs_;
+    /* Forward index, indexed by document ordinal: words of the document, stored
+     * in terms_, with their frequency. Removed documents keep nullptr. */
+    std::vector<std::shared_ptr<const WordFrequencies::Entries>> document_to_word_freqs_;
+
+    // Words of all documents interned to dense term ids.
+    TermDictionary terms_;
+
+    /* Inverted index: segments in the order of ordinals, the last one is mutable.
+     * std::deque keeps sealed segments in place while new ones are added,
+     * so a merge can read them without holding the lock. */
+    std::deque<IndexSegment> segments_ = { IndexSegment(0) };
+
+    // Count of live documents containing the term and its IDF, indexed by term id.
+    IdfTable idfs_;
 
     /* @param int - document id;
-     * @param DocumentData: document status and rating; */
-    std::map<int, DocumentData> documents_;
+     * @param Ordinal - dense ordinal of the document; */
+    std::unordered_map<int, Ordinal> document_ordinals_;
+
+    // Document status and rating by ordinal.
+    DocumentData documents_;
+
+    // Results of recent queries, disabled by default.
+    mutable QueryCache query_cache_;
+
+    /* @brief Implementation of AddDocuments for both execution policies. */
+    template <typename ExecutionPolicy>
+    void AddDocumentBatch(const ExecutionPolicy& policy, const std::vector<DocumentInput>& documents);
 
     /* @brief Average rating calculation.
      * @param ratings - vector of ratings.
@@ -151,8 +388,8 @@ private:
 
     /* @brief Splits the string into a vector and cheks valid.
      * @param text - string to split.
-     * @return Vector of words. */
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string_view text) const;
+     * @return Vector of words, the words point into the text. */
+    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
 
     /* @brief Forming a QueryWord structure from an input string.
      * @param text - the string from which the QueryWord is formed.
@@ -162,28 +399,147 @@ private:
 
     /* @brief Forming a Query structure from an input string.
      * @param text - the string from which the Query is formed.
+     * @param profile - trace receiving the stop words and the time, may be nullptr.
      * @return struct Query.
      * @see SearchServer::Query. */
-    Query ParseQuery(const std::string_view text) const;
+    Query ParseQuery(const std::string_view text, QueryProfile* profile) const;
+
+    /* @brief Key of a query in the result cache. Words are sorted and unique,
+     *        so queries differing in word order or repeats share the key.
+     * @return Words, filter and top count of the query in one string. */
+    static std::string MakeQueryKey(const Query& query, const DocumentFilter& filter, size_t top_count);
 
     /* @brief Calculate IDF  inverse document frequency.
-     * @param word - word for composing it IDF.
+     * @param term - id of the word for composing it IDF.
      * @return IDF word. */
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    double ComputeWordInverseDocumentFreq(TermDictionary::TermId term) const;
+
+    /* @brief Part of a posting list scored by one task of the parallel search.
+     * @param segment - segment of the posting list.
+     * @param postings - posting list of the word.
+     * @param first_block, last_block - blocks of the chunk in the posting list.
+     * @param inverse_document_freq - IDF of the word. */
+    struct PostingChunk
+    {
+        const IndexSegment* segment;
+        const PostingList* postings;
+        size_t first_block;
+        size_t last_block;
+        double inverse_document_freq;
+    };
 
-    /* @brief Lists documents found by query.
-     *  1. sort by plus and minus words;
-     *  2. sorting by DocumentPredicate.
-     * @param query - custom document search query.
-     * @param document_predicate - custom sort predicate.
-     * @return Vector documents ranked by rating. */
+    /* @brief Splitting of the posting lists of the words into chunks.
+     * @param words - query words.
+     * @return Chunks of at most POSTING_CHUNK_BLOCKS posting blocks. */
+    std::vector<PostingChunk> SplitIntoPostingChunks(const std::set<std::string_view, std::less<>>& words) const;
+
+    /* @param document - ordinal of a live document.
+     * @return Segment containing the document. */
+    IndexSegment& FindSegment(Ordinal document);
+
+    const IndexSegment& FindSegment(Ordinal document) const;
+
+    /* @brief Seals the mutable segment if it is full and starts the background merge if needed.
+     *        Called under the exclusive lock. */
+    void SealTailSegment();
+
+    /* @brief Starts the background merge if the merge policy chooses any segments.
+     *        Called under the exclusive lock. */
+    void StartMergeIfNeeded();
+
+    /* @brief Merge policy: a sealed segment with too many removed documents is rewritten,
+     *        SEGMENT_MERGE_FACTOR adjacent sealed segments of one size tier are merged.
+     * @return Range of segments to merge, empty if nothing to merge. */
+    std::pair<size_t, size_t> SelectSegmentsToMerge() const;
+
+    /* @brief Merges one range of segments chosen by the policy.
+     * @return false if nothing needed merging. */
+    bool MergeNextSegments();
+
+    /* @param document_id - external document id.
+     * @return Ordinal of the document.
+     * @throw std::out_of_range if the document does not exist. */
+    Ordinal GetOrdinal(int document_id) const;
+
+    /* @brief Check of a document by the predicate of a query.
+     *        A DocumentFilter is applied to the document columns it restricts,
+     *        any other predicate is called with all fields of the document.
+     * @param document_predicate - custom predicate or DocumentFilter.
+     * @param document - ordinal of the document.
+     * @return true if the document is accepted. */
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&,
-        const Query& query, DocumentPredicate document_predicate) const;
+    bool IsAccepted(DocumentPredicate& document_predicate, Ordinal document) const;
+
+    /* @brief Cursor over the posting list of a query word in one segment.
+     * @param position - current posting.
+     * @param postings - posting list of the word.
+     * @param inverse_document_freq - IDF of the word.
+     * @param max_score - upper bound of the relevance added by the word. */
+    struct TermCursor
+    {
+        PostingList::Iterator position;
+        const PostingList* postings;
+        double inverse_document_freq;
+        double max_score;
+    };
 
+    /* @brief Query words present in the index.
+     * @param words - query words.
+     * @param with_idf - whether to compute IDF of the words.
+     * @return Term ids of the words with their IDF. */
+    std::vector<std::pair<TermDictionary::TermId, double>> FindQueryTerms(const std::set<std::string_view, std::less<>>& words,
+        bool with_idf) const;
+
+    /* @brief Documents containing any of the minus words, collected before scoring,
+     *        so that scoring skips them with one lookup per document.
+     * @param words - minus words of the query.
+     * @param profile - trace receiving the minus terms and the time, may be nullptr. */
+    OrdinalBitmap FindExcludedDocuments(const std::set<std::string_view, std::less<>>& words, QueryProfile* profile) const;
+
+    /* @brief Posting counts of the query words for a trace, called under the lock.
+     * @param with_idf - whether to compute IDF of the words.
+     * @return Terms of the trace, in the order of the words. */
+    std::vector<QueryProfile::Term> ProfileTerms(const std::set<std::string_view, std::less<>>& words, bool with_idf) const;
+
+    /* @return Cursors at the beginning of the posting lists of the terms in the segment. */
+    static std::vector<TermCursor> MakeTermCursors(const IndexSegment& segment,
+        const std::vector<std::pair<TermDictionary::TermId, double>>& terms);
+
+    /* @brief Implementation of FindTopDocuments: parsing, the result cache and ranking.
+     * @param control - cancellation and deadline of the query, nullptr if there are none.
+     * @param profile - trace of the query, nullptr if it is not traced. A traced query bypasses the cache. */
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> RunQuery(ExecutionPolicy& policy, const std::string_view raw_query,
+        DocumentPredicate document_predicate, size_t top_count, const QueryControl* control, QueryProfile* profile) const;
+
+    /* @brief Top documents by query, the index is locked inside.
+     *        The sequential search is document-at-a-time with MaxScore pruning:
+     *        documents that can not reach the current top are not scored in full.
+     *        The parallel search scores all documents and selects the top.
+     * @param query - parsed query.
+     * @param document_predicate - custom filter of documents.
+     * @param top_count - maximum count of documents in the result.
+     * @param control - checked every QUERY_CONTROL_CHECK_INTERVAL candidates, may be nullptr.
+     * @param profile - trace of the query, may be nullptr.
+     * @return Documents ordered by IsMoreRelevant. */
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&,
-        const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> RankDocuments(const std::execution::sequenced_policy&, const Query& query,
+        DocumentPredicate document_predicate, size_t top_count, const QueryControl* control, QueryProfile* profile) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> RankDocuments(const std::execution::parallel_policy&, const Query& query,
+        DocumentPredicate document_predicate, size_t top_count, const QueryControl* control, QueryProfile* profile) const;
+
+    /* @brief Lists all documents found by query, scored term-at-a-time in parallel.
+     * @param query - custom document search query.
+     * @param document_predicate - custom filter of documents.
+     * @param control - polled by every task every QUERY_CONTROL_CHECK_INTERVAL postings,
+     *        once it stops all tasks return early and the result is incomplete. May be nullptr.
+     * @param profile - trace of the query, may be nullptr.
+     * @return Documents with their relevance, unordered. */
+    template <typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+        DocumentPredicate document_predicate, const QueryControl* control, QueryProfile* profile) const;
 };
 
 
@@ -206,31 +562,25 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query,
-    DocumentPredicate document_predicate) const
+    DocumentPredicate document_predicate, size_t top_count) const
 {
-    const auto query = ParseQuery(raw_query);
-
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-    std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs)
-        {
-            return (std::abs(lhs.relevance - rhs.relevance) < 1e-6) ?
-                lhs.rating > rhs.rating : lhs.relevance > rhs.relevance;
-        });
-
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    return RunQuery(policy, raw_query, document_predicate, top_count, nullptr, nullptr);
+}
 
-    return matched_documents;
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::pair<std::vector<Document>, QueryProfile> SearchServer::ExplainTopDocuments(ExecutionPolicy& policy,
+    const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const
+{
+    QueryProfile profile;
+    std::vector<Document> documents = RunQuery(policy, raw_query, document_predicate, top_count, nullptr, &profile);
+    return { std::move(documents), std::move(profile) };
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status,
+    size_t top_count) const
 {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-        {
-            return document_status == status;
-        });
+    return FindTopDocuments(policy, raw_query, DocumentFilter::ForStatus(status), top_count);
 }
 
 template <typename ExecutionPolicy>
@@ -241,98 +591,325 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy& policy, co
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query,
-    DocumentPredicate document_predicate) const
+    DocumentPredicate document_predicate, size_t top_count) const
 {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, top_count);
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&,
-    const Query& query, DocumentPredicate document_predicate) const
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::RunQuery(ExecutionPolicy& policy, const std::string_view raw_query,
+    DocumentPredicate document_predicate, size_t top_count, const QueryControl* control, QueryProfile* profile) const
 {
-    std::map<int, double> document_to_relevance;
-    std::vector<Document> matched_documents;
+    StageTimer query_timer(MetricStage::QUERY, QueryProfile::GetStageTimeTarget(profile, MetricStage::QUERY));
+    Metrics::Add(MetricCounter::QUERIES);
 
-    for (const std::string_view& word : query.plus_words)
-    {
-        if (word_to_document_freqs_.count(word) == 0)
-            continue;
+    if (control)
+        control->ThrowIfStopped();
 
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(std::string{ word }))
-        {
-            const auto& document_data = documents_.at(document_id);
+    const auto query = ParseQuery(raw_query, profile);
 
-            if (document_predicate(document_id, document_data.status, document_data.rating))
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>)
+    {
+        if (query_cache_.IsEnabled() && (profile == nullptr))
+        {
+            std::string key = MakeQueryKey(query, document_predicate, top_count);
+            if (auto documents = query_cache_.Find(key))
+                return std::move(*documents);
+
+            // Taken before ranking: if the index changes meanwhile, the result is not cached.
+            const uint64_t generation = query_cache_.GetGeneration();
+            std::vector<Document> documents = RankDocuments(policy, query, document_predicate, top_count, control, nullptr);
+            query_cache_.Insert(std::move(key), generation, documents);
+            return documents;
         }
     }
 
-    for (const std::string_view& word : query.minus_words)
-    {
-        if (word_to_document_freqs_.count(word) == 0)
-            continue;
+    return RankDocuments(policy, query, document_predicate, top_count, control, profile);
+}
 
-        for (const auto& [document_id, _] : word_to_document_freqs_.at(std::string{ word }))
-            document_to_relevance.erase(document_id);
+template <typename DocumentPredicate>
+bool SearchServer::IsAccepted(DocumentPredicate& document_predicate, Ordinal document) const
+{
+    if constexpr (std::is_same_v<std::remove_const_t<DocumentPredicate>, DocumentFilter>)
+    {
+        const DocumentFilter& filter = document_predicate;
+        return (!filter.IsStatusRestricted() || filter.HasStatus(documents_.statuses[document]))
+            && (!filter.IsRatingRestricted()
+                || ((documents_.ratings[document] >= filter.min_rating) && (documents_.ratings[document] <= filter.max_rating)))
+            && (!filter.IsIdRestricted()
+                || ((documents_.ids[document] >= filter.min_id) && (documents_.ids[document] <= filter.max_id)));
     }
-
-    for (const auto& [document_id, relevance] : document_to_relevance)
+    else
     {
-        matched_documents.push_back({ document_id,
-                                      relevance,
-                                      documents_.at(document_id).rating });
+        return document_predicate(documents_.ids[document], documents_.statuses[document], documents_.ratings[document]);
     }
-
-    return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&,
-    const Query& query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::RankDocuments(const std::execution::sequenced_policy&, const Query& query,
+    DocumentPredicate document_predicate, size_t top_count, const QueryControl* control, QueryProfile* profile) const
 {
-    std::map<int, double> document_to_relevance;
-    std::vector<Document> matched_documents;
-    std::vector<std::string_view> words(word_to_document_freqs_.size());
-    size_t words_size = 0;
+    if (top_count == 0)
+        return {};
+
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+
+    if (profile)
+        profile->plus_terms = ProfileTerms(query.plus_words, true);
+
+    const auto plus_terms = FindQueryTerms(query.plus_words, true);
+    const OrdinalBitmap excluded_documents = FindExcludedDocuments(query.minus_words, profile);
+    const PostingList::Sentinel end;
 
-    std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-        words.begin(),
-        [this, &words_size](const auto& word)
-        { ++words_size;  return word_to_document_freqs_.count(word) != 0; });
+    StageTimer traversal_timer(MetricStage::POSTING_TRAVERSAL,
+        QueryProfile::GetStageTimeTarget(profile, MetricStage::POSTING_TRAVERSAL));
+    uint64_t candidate_count = 0;
+    uint64_t excluded_count = 0;
+    uint64_t filtered_count = 0;
+    uint64_t pruned_count = 0;
+    uint64_t scored_count = 0;
 
-    words.resize(words_size);
+    TopDocuments top_documents(top_count);
 
-    for (const std::string_view& word : words)
+    // A document whose relevance is below the threshold can not enter the top.
+    double threshold = -std::numeric_limits<double>::infinity();
+
+    for (const IndexSegment& segment : segments_)
     {
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(std::string{ word }))
+        if (control)
+            control->ThrowIfStopped();
+
+        std::vector<TermCursor> cursors = MakeTermCursors(segment, plus_terms);
+
+        // Words are ordered by their maximum score. The first words are non-essential
+        // while the sum of their maximums is below the threshold: a document containing
+        // only them can not enter the top, so candidates come from essential words.
+        std::sort(cursors.begin(), cursors.end(),
+            [](const TermCursor& lhs, const TermCursor& rhs) { return lhs.max_score < rhs.max_score; });
+
+        std::vector<double> max_score_sums(cursors.size());
+        double max_score_sum = 0.0;
+        for (size_t i = 0; i < cursors.size(); ++i)
         {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating))
+            max_score_sum += cursors[i].max_score;
+            max_score_sums[i] = max_score_sum;
+        }
+
+        size_t first_essential = 0;
+        const auto update_essential = [&]()
+        {
+            while ((first_essential < cursors.size()) && (max_score_sums[first_essential] < threshold))
+                ++first_essential;
+        };
+        update_essential();
+
+        while (first_essential < cursors.size())
+        {
+            Ordinal document = std::numeric_limits<Ordinal>::max();
+            for (size_t i = first_essential; i < cursors.size(); ++i)
+            {
+                if (cursors[i].position != end)
+                    document = std::min(document, cursors[i].position->document);
+            }
+            if (document == std::numeric_limits<Ordinal>::max())
+                break;
+
+            // Essential words are scored and moved past the document.
+            double relevance = 0.0;
+            for (size_t i = first_essential; i < cursors.size(); ++i)
+            {
+                TermCursor& cursor = cursors[i];
+                if ((cursor.position != end) && (cursor.position->document == document))
+                {
+                    relevance += cursor.position->term_count * documents_.inv_word_counts[document] * cursor.inverse_document_freq;
+                    ++cursor.position;
+                }
+            }
+
+            ++candidate_count;
+            if (control && (candidate_count % QUERY_CONTROL_CHECK_INTERVAL == 0))
+                control->ThrowIfStopped();
+
+            if (segment.IsRemoved(document))
+                continue;
+
+            if (excluded_documents.Contains(document))
+            {
+                ++excluded_count;
+                continue;
+            }
+
+            if (!IsAccepted(document_predicate, document))
+            {
+                ++filtered_count;
+                continue;
+            }
+
+            // Non-essential words from the highest maximum, until the rest can not
+            // lift the document to the threshold. The maximum of the block that may
+            // contain the document is a tighter bound than the maximum of the list.
+            bool is_pruned = false;
+            for (size_t i = first_essential; i-- > 0;)
+            {
+                TermCursor& cursor = cursors[i];
+                const double rest_max_score = (i > 0) ? max_score_sums[i - 1] : 0.0;
+                const double block_max_score = cursor.postings->GetMaxTermFreq(document) * cursor.inverse_document_freq;
+                if (relevance + block_max_score + rest_max_score < threshold)
+                {
+                    is_pruned = true;
+                    break;
+                }
+
+                cursor.position.SkipTo(document);
+                if ((cursor.position != end) && (cursor.position->document == document))
+                    relevance += cursor.position->term_count * documents_.inv_word_counts[document] * cursor.inverse_document_freq;
+            }
+
+            if (is_pruned)
+            {
+                ++pruned_count;
+                continue;
+            }
+
+            ++scored_count;
+            if (top_documents.Add({ documents_.ids[document], relevance, documents_.ratings[document] }) && top_documents.IsFull())
             {
-                document_to_relevance[document_id] += term_freq * ComputeWordInverseDocumentFreq(word);
+                threshold = top_documents.GetWorst().relevance - RELEVANCE_EPSILON;
+                update_essential();
             }
         }
     }
 
-    for (const std::string_view& word : query.minus_words)
+    traversal_timer.Stop();
+    Metrics::Add(MetricCounter::CANDIDATE_DOCUMENTS, candidate_count);
+    Metrics::Add(MetricCounter::EXCLUDED_DOCUMENTS, excluded_count);
+    Metrics::Add(MetricCounter::FILTERED_DOCUMENTS, filtered_count);
+    Metrics::Add(MetricCounter::PRUNED_DOCUMENTS, pruned_count);
+
+    if (profile)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        profile->candidate_documents = candidate_count;
+        profile->excluded_documents = excluded_count;
+        profile->filtered_documents = filtered_count;
+        profile->pruned_documents = pruned_count;
+        profile->scored_documents = scored_count;
+    }
+
+    StageTimer selection_timer(MetricStage::TOP_SELECTION, QueryProfile::GetStageTimeTarget(profile, MetricStage::TOP_SELECTION));
+    return top_documents.Extract();
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::RankDocuments(const std::execution::parallel_policy& policy, const Query& query,
+    DocumentPredicate document_predicate, size_t top_count, const QueryControl* control, QueryProfile* profile) const
+{
+    // An exception must not leave the parallel scoring: the scoring only stops early,
+    // the control throws after it.
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    const auto matched_documents = FindAllDocuments(policy, query, document_predicate, control, profile);
+    lock.unlock();
+
+    if (control)
+        control->ThrowIfStopped();
+
+    StageTimer selection_timer(MetricStage::TOP_SELECTION, QueryProfile::GetStageTimeTarget(profile, MetricStage::TOP_SELECTION));
+    return SelectTopDocuments(policy, matched_documents, top_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+    DocumentPredicate document_predicate, const QueryControl* control, QueryProfile* profile) const
+{
+    ConcurrentMap<Ordinal, double> document_to_relevance(RELEVANCE_BUCKET_COUNT);
+    std::vector<Document> matched_documents;
+
+    if (profile)
+        profile->plus_terms = ProfileTerms(query.plus_words, true);
+
+    // Excluded documents are known before scoring, so they never get into the map.
+    const OrdinalBitmap excluded_documents = FindExcludedDocuments(query.minus_words, profile);
+
+    StageTimer traversal_timer(MetricStage::POSTING_TRAVERSAL,
+        QueryProfile::GetStageTimeTarget(profile, MetricStage::POSTING_TRAVERSAL));
+
+    // Long posting lists are split, so one frequent word is scored by many threads.
+    const std::vector<PostingChunk> plus_chunks = SplitIntoPostingChunks(query.plus_words);
+
+    // Counted per chunk, then added once.
+    std::atomic<uint64_t> candidate_total = 0;
+    std::atomic<uint64_t> excluded_total = 0;
+    std::atomic<uint64_t> filtered_total = 0;
+
+    // Set by the task that finds the query stopped, the other tasks poll it.
+    std::atomic<bool> is_stopped = false;
+
+    std::for_each(std::execution::par, plus_chunks.begin(), plus_chunks.end(),
+        [this, &document_to_relevance, &excluded_documents, &document_predicate, control, &is_stopped,
+         &candidate_total, &excluded_total, &filtered_total](const PostingChunk& chunk)
         {
-            continue;
-        }
+            uint64_t candidate_count = 0;
+            uint64_t excluded_count = 0;
+            uint64_t filtered_count = 0;
+
+            if (is_stopped.load(std::memory_order_relaxed) || (control && control->IsStopped()))
+            {
+                is_stopped.store(true, std::memory_order_relaxed);
+                return;
+            }
 
-        for (const auto& [document_id, _] : word_to_document_freqs_.at(std::string{ word }))
+            for (const auto [document, term_count] : chunk.postings->GetBlocks(chunk.first_block, chunk.last_block))
+            {
+                ++candidate_count;
+                if (control && (candidate_count % QUERY_CONTROL_CHECK_INTERVAL == 0))
+                {
+                    if (is_stopped.load(std::memory_order_relaxed) || control->IsStopped())
+                    {
+                        is_stopped.store(true, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+
+                if (chunk.segment->IsRemoved(document))
+                    continue;
+
+                if (excluded_documents.Contains(document))
+                {
+                    ++excluded_count;
+                    continue;
+                }
+
+                if (!IsAccepted(document_predicate, document))
+                {
+                    ++filtered_count;
+                    continue;
+                }
+
+                document_to_relevance[document].ref_to_value +=
+                    term_count * documents_.inv_word_counts[document] * chunk.inverse_document_freq;
+            }
+
+            candidate_total += candidate_count;
+            excluded_total += excluded_count;
+            filtered_total += filtered_count;
+        });
+
+    Metrics::Add(MetricCounter::CANDIDATE_DOCUMENTS, candidate_total);
+    Metrics::Add(MetricCounter::EXCLUDED_DOCUMENTS, excluded_total);
+    Metrics::Add(MetricCounter::FILTERED_DOCUMENTS, filtered_total);
+
+    document_to_relevance.ForEach([this, &matched_documents](Ordinal document, double relevance)
         {
-            document_to_relevance.erase(document_id);
-        }
-    }
+            matched_documents.push_back({ documents_.ids[document],
+                                          relevance,
+                                          documents_.ratings[document] });
+        });
 
-    for (const auto& [document_id, relevance] : document_to_relevance)
+    if (profile)
     {
-        matched_documents.push_back({ document_id,
-                                      relevance,
-                                      documents_.at(document_id).rating });
+        profile->candidate_documents = candidate_total;
+        profile->excluded_documents = excluded_total;
+        profile->filtered_documents = filtered_total;
+        profile->scored_documents = matched_documents.size();
     }
 
     return matched_documents;
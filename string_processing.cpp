@@ -4,53 +4,24 @@
 
 #include "string_processing.h"
 
-std::vector<std::string> SplitIntoWords(const std::string& text)
+std::vector<std::string> SplitIntoWords(const std::string_view text)
 {
     std::vector<std::string> words;
-    std::string word;
-
-    for (const char c : text)
-    {
-        if (c == ' ')
-        {
-            if (!word.empty())
-            {
-                words.push_back(word);
-                word.clear();
-            }
-        }
-        else
+    ForEachWord(text, [&words](const std::string_view word)
         {
-            word += c;
-        }
-    }
-    if (!word.empty())
-    {
-        words.push_back(word);
-    }
-
+            words.emplace_back(word);
+        });
     return words;
 }
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view str)
+std::vector<std::string_view> SplitIntoWordsView(const std::string_view text)
 {
-    std::vector<std::string_view> result;
-    const size_t pos_end = str.npos;
-    while (true)
-    {
-        size_t space = str.find(' ', 0);
-        result.push_back(space == pos_end ? str.substr(0) : str.substr(0, space));
-        if (space == pos_end)
+    std::vector<std::string_view> words;
+    ForEachWord(text, [&words](const std::string_view word)
         {
-            break;
-        }
-        else
-        {
-            str.remove_prefix(space + 1);
-        }
-    }
-
-    return result;
+            words.push_back(word);
+        });
+    return words;
 }
 
 int ReadLineWithNumber()
@@ -76,12 +47,3 @@ bool IsValidWord(const std::string_view word)
             return c >= '\0' && c < ' ';
         });
 }
-
-bool IsValidWord(const std::string& word)
-{
-    // A valid word must not contain special characters
-    return std::none_of(word.begin(), word.end(), [](char c)
-        {
-            return c >= '\0' && c < ' ';
-        });
-}
\ No newline at end of file
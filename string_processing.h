@@ -5,8 +5,85 @@
 #include <set>
 #include <string_view>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+/* @brief Check that the character can not be a part of a word:
+ *        a space or a special character (codes 0-31). */
+inline bool IsWordBreak(char c)
+{
+    return static_cast<unsigned char>(c) <= static_cast<unsigned char>(' ');
+}
+
+/* @brief Search of the first space or special character.
+ *        Eight characters are checked at once while none of them is a break.
+ * @param first, last - characters to scan.
+ * @return Position of the break or last. */
+inline const char* FindWordBreak(const char* first, const char* last)
+{
+    constexpr uint64_t ONES = 0x0101010101010101ull;
+    constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+    constexpr uint64_t BREAK_LIMIT = ONES * (' ' + 1);
+
+    while (last - first >= static_cast<std::ptrdiff_t>(sizeof(uint64_t)))
+    {
+        uint64_t chunk;
+        std::memcpy(&chunk, first, sizeof(chunk));
+        // A high bit is set for every byte less than BREAK_LIMIT (and never for other bytes).
+        if (((chunk - BREAK_LIMIT) & ~chunk & HIGH_BITS) != 0)
+            break;
+        first += sizeof(chunk);
+    }
+
+    while ((first != last) && !IsWordBreak(*first))
+    {
+        ++first;
+    }
+    return first;
+}
+
+/* @brief Streaming tokenizer. Calls the handler for every word of the text.
+ *        Words are separated by spaces, repeated spaces do not produce empty words.
+ *        Words are checked for special characters in the same pass, nothing is allocated.
+ * @param text - text to split.
+ * @param handler - function called with std::string_view of every word.
+ * @throw std::invalid_argument if a word contains special characters. */
+template <typename WordHandler>
+void ForEachWord(const std::string_view text, WordHandler handler)
+{
+    const char* position = text.data();
+    const char* const last = text.data() + text.size();
+
+    while (position != last)
+    {
+        if (*position == ' ')
+        {
+            ++position;
+            continue;
+        }
+
+        const char* const word_begin = position;
+        bool is_valid = true;
+
+        position = FindWordBreak(position, last);
+        while ((position != last) && (*position != ' '))
+        {
+            // A special character inside of a word makes the whole word invalid.
+            is_valid = false;
+            position = FindWordBreak(position + 1, last);
+        }
+
+        const std::string_view word(word_begin, static_cast<size_t>(position - word_begin));
+        if (!is_valid)
+        {
+            throw std::invalid_argument("Word " + std::string{ word } + " is invalid");
+        }
+        handler(word);
+    }
+}
+
+std::vector<std::string> SplitIntoWords(const std::string_view text);
 
 std::vector<std::string_view> SplitIntoWordsView(const std::string_view text);
 
@@ -19,11 +96,6 @@ std::string ReadLine();
  * @return Correct (true) or incorrect (false). */
 bool IsValidWord(const std::string_view word);
 
-/* @brief Check the absence of special characters in the word.
- * @param word - word to check.
- * @return Correct (true) or incorrect (false). */
-bool IsValidWord(const std::string& word);
-
 /* @brief Method of composing unique words.
  * @param strings - container contains non-unique words.
  * @return Unique words */
@@ -0,0 +1,43 @@
+#include "term_dictionary.h"
+
+#include <utility>
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : terms_(other.terms_)
+{
+    term_to_id_.reserve(terms_.size());
+    for (TermId term = 0; term < terms_.size(); ++term)
+    {
+        term_to_id_.emplace(terms_[term], term);
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other)
+{
+    if (this != &other)
+    {
+        TermDictionary copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+TermDictionary::TermId TermDictionary::Intern(const std::string_view word)
+{
+    if (const auto it = term_to_id_.find(word); it != term_to_id_.end())
+    {
+        return it->second;
+    }
+
+    const TermId term = static_cast<TermId>(terms_.size());
+    const std::string& stored_word = terms_.emplace_back(word);
+    term_to_id_.emplace(stored_word, term);
+
+    return term;
+}
+
+TermDictionary::TermId TermDictionary::Find(const std::string_view word) const noexcept
+{
+    const auto it = term_to_id_.find(word);
+    return (it == term_to_id_.end()) ? NO_TERM : it->second;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* @brief Term dictionary of the search server.
+ *        Every distinct word is stored once and interned to a dense id,
+ *        so the index can keep its posting lists in a flat vector
+ *        indexed by that id. Lookups are done by std::string_view
+ *        and never build a temporary std::string. */
+class TermDictionary
+{
+public:
+    using TermId = uint32_t;
+
+    static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+    TermDictionary() = default;
+
+    // A copy indexes its own words, the views of the source are not copied.
+    TermDictionary(const TermDictionary& other);
+
+    TermDictionary& operator=(const TermDictionary& other);
+
+    // Moving keeps the words in place, so the views move with them.
+    TermDictionary(TermDictionary&&) = default;
+
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    /* @brief Returns the id of the word, adding the word if it is new.
+     * @param word - word to intern.
+     * @return Dense term id. */
+    TermId Intern(const std::string_view word);
+
+    /* @brief Term id lookup without modifying the dictionary.
+     * @param word - word to find.
+     * @return Term id or NO_TERM if the word has never been interned. */
+    TermId Find(const std::string_view word) const noexcept;
+
+    /* @param term - id returned by Intern.
+     * @return Word stored in the dictionary. Stays valid while the dictionary lives. */
+    inline std::string_view GetTerm(TermId term) const
+    {
+        return terms_[term];
+    }
+
+    inline size_t size() const noexcept
+    {
+        return terms_.size();
+    }
+
+private:
+    // std::deque never relocates its elements, so the views in term_to_id_ stay valid.
+    // They point into this dictionary only, a copy rebuilds them.
+    std::deque<std::string> terms_;
+    std::unordered_map<std::string_view, TermId> term_to_id_;
+};
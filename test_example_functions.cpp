@@ -1,8 +1,20 @@
 #include "test_example_functions.h"
 #include "search_server.h"
+#include "process_queries.h"
+#include "thread_pool.h"
+#include "concurrent_map.h"
+#include "corpus_loader.h"
+#include "posting_list.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
 
 #include <iostream>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <thread>
 
 using namespace std::string_literals;
 
@@ -166,6 +178,1176 @@ namespace search_server_testing
         ASSERT_EQUAL_HINT(relevance2, control_relevance2, error_message);
     }
 
+    void TestCopyServer()
+    {
+        // The copy must not refer to the words of the source after the source is destroyed.
+        auto source = std::make_unique<SearchServer>("and with"s);
+        source->AddDocument(1, "white cat and fashion collar"s, DocumentStatus::ACTUAL, { 1 });
+        source->AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 2 });
+
+        SearchServer copy(*source);
+        source.reset();
+
+        ASSERT_EQUAL(copy.FindTopDocuments("fluffy cat"s).size(), 2u);
+        ASSERT_EQUAL(copy.GetWordFrequencies(2).GetFrequency("fluffy"s), 0.5);
+
+        copy.AddDocument(3, "groomed cat with collar"s, DocumentStatus::ACTUAL, { 3 });
+        copy.AddDocument(4, "fluffy dog"s, DocumentStatus::ACTUAL, { 4 });
+        ASSERT_EQUAL(copy.FindTopDocuments("collar"s).size(), 2u);
+        ASSERT_EQUAL(copy.FindTopDocuments(std::execution::par, "fluffy"s).size(), 2u);
+
+        const auto [words, status] = copy.MatchDocument("fashion collar"s, 1);
+        ASSERT_EQUAL(words.size(), 2u);
+        ASSERT(status == DocumentStatus::ACTUAL);
+    }
+
+    void TestRemoveDocument()
+    {
+        const std::string error_message("Removed document is still indexed");
+
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "white cat and fashion collar"s, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 2 });
+        search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 3 });
+
+        search_server.RemoveDocument(1);
+        search_server.RemoveDocument(std::execution::par, 3);
+
+        ASSERT_EQUAL_HINT(search_server.GetDocumentCount(), 1, error_message);
+        ASSERT_HINT(search_server.FindTopDocuments("collar dog"s).empty(), error_message);
+        ASSERT_HINT(search_server.GetWordFrequencies(1).empty(), error_message);
+
+        // A view taken before the removal keeps the words of the document.
+        const WordFrequencies word_frequencies = search_server.GetWordFrequencies(2);
+        search_server.RemoveDocument(2);
+        ASSERT_EQUAL_HINT(word_frequencies.size(), 3u, error_message);
+        ASSERT_EQUAL_HINT(word_frequencies.begin()->word, "cat"s, error_message);
+        ASSERT_EQUAL_HINT(word_frequencies.GetFrequency("fluffy"s), 0.5, error_message);
+        ASSERT_EQUAL_HINT(word_frequencies.GetFrequency("dog"s), 0.0, error_message);
+        search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 2 });
+
+        const std::vector<Document> verification_documents = search_server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL_HINT(verification_documents.size(), 1u, error_message);
+        ASSERT_EQUAL_HINT(verification_documents[0].id, 2, error_message);
+    }
+
+    void TestTopDocumentsCount()
+    {
+        const std::string error_message("Incorrect count of top documents");
+
+        SearchServer search_server(""s);
+        for (int document_id = 0; document_id < 10; ++document_id)
+        {
+            search_server.AddDocument(document_id, "cat"s + std::string(document_id, 'x') + " cat dog"s,
+                DocumentStatus::ACTUAL, { document_id });
+        }
+
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments("cat"s).size(), MAX_RESULT_DOCUMENT_COUNT, error_message);
+        ASSERT_HINT(search_server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 0).empty(), error_message);
+
+        const std::vector<Document> top_three = search_server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 3);
+        const std::vector<Document> top_three_par =
+            search_server.FindTopDocuments(std::execution::par, "cat"s, DocumentStatus::ACTUAL, 3);
+
+        ASSERT_EQUAL_HINT(top_three.size(), 3u, error_message);
+        ASSERT_EQUAL_HINT(top_three_par.size(), 3u, error_message);
+        for (size_t i = 0; i < top_three.size(); ++i)
+        {
+            // Equal relevance everywhere, so the rating decides.
+            ASSERT_EQUAL_HINT(top_three[i].rating, 9 - static_cast<int>(i), error_message);
+            ASSERT_EQUAL_HINT(top_three_par[i].id, top_three[i].id, error_message);
+        }
+    }
+
+    void TestSnapshot()
+    {
+        const std::string error_message("Incorrect snapshot save or load");
+        const std::string path = (std::filesystem::temp_directory_path() / "search_server_test.snapshot").string();
+
+        SearchServer search_server = GetSearchServer();
+        search_server.RemoveDocument(2);
+        search_server.SaveSnapshot(path);
+
+        const SearchServer loaded_server = SearchServer::LoadSnapshot(path);
+        ASSERT_EQUAL_HINT(loaded_server.GetDocumentCount(), search_server.GetDocumentCount(), error_message);
+
+        for (const int document_id : search_server)
+        {
+            ASSERT_HINT(loaded_server.GetWordFrequencies(document_id) == search_server.GetWordFrequencies(document_id),
+                error_message);
+            ASSERT_EQUAL_HINT(loaded_server.GetDocumentFingerprint(document_id), search_server.GetDocumentFingerprint(document_id),
+                error_message);
+        }
+
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED })
+        {
+            const std::vector<Document> expected = search_server.FindTopDocuments("  "s, status);
+            const std::vector<Document> loaded = loaded_server.FindTopDocuments("  "s, status);
+            ASSERT_EQUAL_HINT(loaded.size(), expected.size(), error_message);
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(loaded[i].id, expected[i].id, error_message);
+                ASSERT_EQUAL_HINT(loaded[i].relevance, expected[i].relevance, error_message);
+            }
+        }
+
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(-1, std::ios::end);
+            file.put('\x7f');
+        }
+
+        bool is_corruption_detected = false;
+        try
+        {
+            SearchServer::LoadSnapshot(path);
+        }
+        catch (const std::runtime_error&)
+        {
+            is_corruption_detected = true;
+        }
+        std::filesystem::remove(path);
+
+        ASSERT_HINT(is_corruption_detected, "Corrupted snapshot must not be loaded");
+    }
+
+    void TestWordSplitting()
+    {
+        const std::string error_message("Incorrect splitting into words");
+
+        ASSERT_EQUAL_HINT(SplitIntoWordsView("  white   cat  "s), (std::vector<std::string_view>{ "white", "cat" }), error_message);
+        ASSERT_EQUAL_HINT(SplitIntoWords("a long word list with separators"s).size(), 6u, error_message);
+        ASSERT_HINT(SplitIntoWordsView("     "s).empty(), error_message);
+
+        SearchServer search_server("and"s);
+        search_server.AddDocument(1, "  white  cat and   collar "s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT_EQUAL_HINT(search_server.GetWordFrequencies(1).size(), 3u, error_message);
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments("  cat   -dog "s).size(), 1u, error_message);
+
+        bool is_invalid_word_detected = false;
+        try
+        {
+            search_server.AddDocument(2, "black ca\x12t"s, DocumentStatus::ACTUAL, { 1 });
+        }
+        catch (const std::invalid_argument&)
+        {
+            is_invalid_word_detected = true;
+        }
+        ASSERT_HINT(is_invalid_word_detected, "Words with special characters must be rejected");
+        ASSERT_EQUAL_HINT(search_server.GetDocumentCount(), 1, error_message);
+    }
+
+    void TestPostingList()
+    {
+        using Posting = PostingList::Posting;
+
+        // Deltas and counts of one, two, three and four varint bytes, over several blocks.
+        const uint32_t deltas[] = { 1, 127, 128, 300, 16383, 16384, 2097152 };
+        std::vector<Posting> expected;
+        PostingList postings;
+        PostingList::Ordinal document = 5;
+        for (size_t i = 0; i < 2 * PostingList::BLOCK_SIZE + 7; ++i)
+        {
+            const uint32_t term_count = deltas[(i * 3) % std::size(deltas)];
+            expected.push_back({ document, term_count });
+            postings.Append(document, term_count, 0.5);
+            document += deltas[i % std::size(deltas)];
+        }
+        ASSERT_EQUAL(postings.size(), expected.size());
+        ASSERT_EQUAL(postings.GetBlockCount(), 3u);
+
+        const auto assert_postings = [&expected](const PostingList& list)
+        {
+            size_t i = 0;
+            for (const Posting& posting : list)
+            {
+                ASSERT(i < expected.size());
+                ASSERT_EQUAL(posting.document, expected[i].document);
+                ASSERT_EQUAL(posting.term_count, expected[i].term_count);
+                ++i;
+            }
+            ASSERT_EQUAL(i, expected.size());
+        };
+        assert_postings(postings);
+
+        size_t block_posting_count = 0;
+        for (const Posting& posting : postings.GetBlocks(1, 2))
+        {
+            ASSERT_EQUAL(posting.document, expected[PostingList::BLOCK_SIZE + block_posting_count].document);
+            ++block_posting_count;
+        }
+        ASSERT_EQUAL(block_posting_count, PostingList::BLOCK_SIZE);
+
+        // Membership and skips on and just past the first and the last ordinals of every block.
+        ASSERT(!postings.Contains(expected.front().document - 1));
+        for (size_t block = 0; block < postings.GetBlockCount(); ++block)
+        {
+            const size_t first = block * PostingList::BLOCK_SIZE;
+            const size_t last = std::min(first + PostingList::BLOCK_SIZE, expected.size()) - 1;
+
+            for (const size_t i : { first, last })
+            {
+                const bool is_next_in_list = (i + 1 < expected.size()) && (expected[i + 1].document == expected[i].document + 1);
+                ASSERT(postings.Contains(expected[i].document));
+                ASSERT_EQUAL(postings.Contains(expected[i].document + 1), is_next_in_list);
+            }
+
+            PostingList::Iterator it = postings.begin();
+            it.SkipTo(expected[first].document);
+            ASSERT_EQUAL(it->document, expected[first].document);
+            it.SkipTo(expected[first].document + 1);
+            ASSERT_EQUAL(it->document, expected[first + 1].document);
+            it.SkipTo(expected[last].document);
+            ASSERT_EQUAL(it->document, expected[last].document);
+            it.SkipTo(expected[last].document + 1);
+            if (last + 1 < expected.size())
+            {
+                ASSERT_EQUAL(it->document, expected[last + 1].document);
+            }
+            else
+            {
+                ASSERT(it == postings.end());
+            }
+        }
+
+        std::ostringstream out;
+        BinaryWriter writer(out);
+        postings.Save(writer);
+        const std::string data = out.str();
+
+        const PostingList::Ordinal end_document = expected.back().document + 1;
+        BinaryReader reader(data);
+        const PostingList loaded = PostingList::Load(reader, 0, end_document);
+        ASSERT_EQUAL(loaded.size(), postings.size());
+        ASSERT_EQUAL(loaded.GetBlockCount(), postings.GetBlockCount());
+        ASSERT_EQUAL(loaded.GetMaxTermFreq(), postings.GetMaxTermFreq());
+        assert_postings(loaded);
+
+        bool is_truncation_detected = false;
+        try
+        {
+            BinaryReader truncated_reader(std::string_view(data).substr(0, data.size() - 1));
+            PostingList::Load(truncated_reader, 0, end_document);
+        }
+        catch (const std::runtime_error&)
+        {
+            is_truncation_detected = true;
+        }
+        ASSERT_HINT(is_truncation_detected, "Truncated posting list must not be loaded");
+
+        // The last byte is the term frequency of the last posting, with the continuation bit set
+        // its varint runs past the end of the block.
+        std::string corrupted = data;
+        corrupted.back() = static_cast<char>(static_cast<unsigned char>(corrupted.back()) | 0x80);
+        bool is_corruption_detected = false;
+        try
+        {
+            BinaryReader corrupted_reader(corrupted);
+            PostingList::Load(corrupted_reader, 0, end_document);
+        }
+        catch (const std::runtime_error&)
+        {
+            is_corruption_detected = true;
+        }
+        ASSERT_HINT(is_corruption_detected, "Posting list with a corrupted block must not be loaded");
+
+        bool is_out_of_range_detected = false;
+        try
+        {
+            BinaryReader range_reader(data);
+            PostingList::Load(range_reader, 0, expected.back().document);
+        }
+        catch (const std::runtime_error&)
+        {
+            is_out_of_range_detected = true;
+        }
+        ASSERT_HINT(is_out_of_range_detected, "Posting list with ordinals past the end of its segment must not be loaded");
+    }
+
+    void TestAddDocuments()
+    {
+        const std::string error_message("Bulk addition differs from addition one by one");
+
+        const std::vector<DocumentInput> documents = {
+            { 4, "white cat and fashion collar", DocumentStatus::ACTUAL, { 8, -3 } },
+            { 7, "fluffy cat fluffy tail", DocumentStatus::ACTUAL, { 7, 2, 7 } },
+            { 5, "groomed dog expressive eyes", DocumentStatus::BANNED, { 5, -12, 2, 1 } },
+            { 9, "groomed starling eugene", DocumentStatus::ACTUAL, { 9 } },
+        };
+
+        SearchServer expected_server("and with"s);
+        for (const DocumentInput& document : documents)
+        {
+            expected_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+
+        SearchServer sequential_server("and with"s);
+        sequential_server.AddDocuments(documents);
+        SearchServer parallel_server("and with"s);
+        parallel_server.AddDocuments(std::execution::par, documents);
+
+        for (const SearchServer* search_server : { &sequential_server, &parallel_server })
+        {
+            ASSERT_EQUAL_HINT(search_server->GetDocumentCount(), 4, error_message);
+            for (const DocumentInput& document : documents)
+            {
+                ASSERT_HINT(search_server->GetWordFrequencies(document.id) == expected_server.GetWordFrequencies(document.id),
+                    error_message);
+            }
+
+            const std::vector<Document> expected = expected_server.FindTopDocuments("fluffy groomed cat"s);
+            const std::vector<Document> found = search_server->FindTopDocuments("fluffy groomed cat"s);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), error_message);
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, error_message);
+                ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, error_message);
+            }
+        }
+
+        bool is_duplicate_detected = false;
+        try
+        {
+            parallel_server.AddDocuments(std::execution::par, { { 10, "new document", DocumentStatus::ACTUAL, {} },
+                                                                { 7, "duplicate id", DocumentStatus::ACTUAL, {} } });
+        }
+        catch (const std::invalid_argument&)
+        {
+            is_duplicate_detected = true;
+        }
+        ASSERT_HINT(is_duplicate_detected, "Documents with existing ids must be rejected");
+        ASSERT_EQUAL_HINT(parallel_server.GetDocumentCount(), 4, "Rejected batch must not be added partially");
+
+        // A batch after single additions gets a segment of its own, later additions are appended to it.
+        SearchServer mixed_server("and with"s);
+        mixed_server.AddDocument(documents[0].id, documents[0].text, documents[0].status, documents[0].ratings);
+        mixed_server.AddDocuments(std::execution::par, { documents[1], documents[2] });
+        mixed_server.AddDocument(documents[3].id, documents[3].text, documents[3].status, documents[3].ratings);
+        mixed_server.RemoveDocument(documents[1].id);
+        expected_server.RemoveDocument(documents[1].id);
+
+        const std::vector<Document> expected = expected_server.FindTopDocuments("fluffy groomed cat"s);
+        const std::vector<Document> found = mixed_server.FindTopDocuments("fluffy groomed cat"s);
+        ASSERT_EQUAL_HINT(found.size(), expected.size(), error_message);
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found[i].id, expected[i].id, error_message);
+            ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, error_message);
+        }
+    }
+
+
+    void TestConcurrentUpdates()
+    {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "fluffy cat"s, DocumentStatus::ACTUAL, { 1 });
+
+        // Queries run while documents are added and removed,
+        // every one of them must see a consistent index.
+        std::thread writer([&search_server]()
+            {
+                for (int id = 2; id < 300; ++id)
+                {
+                    search_server.AddDocument(id, "groomed cat number "s + std::to_string(id), DocumentStatus::ACTUAL, { id });
+                    if (id % 3 == 0)
+                        search_server.RemoveDocument(id - 1);
+                }
+            });
+
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; ++i)
+        {
+            readers.emplace_back([&search_server]()
+                {
+                    for (int j = 0; j < 200; ++j)
+                    {
+                        const std::vector<Document> found = search_server.FindTopDocuments("fluffy cat"s);
+                        ASSERT_HINT(!found.empty() && (found.front().id == 1), "The document with both words must be the most relevant");
+
+                        const auto [words, status] = search_server.MatchDocument("fluffy cat"s, 1);
+                        ASSERT_EQUAL_HINT(words.size(), 2u, "Concurrent updates must not affect other documents");
+                    }
+                });
+        }
+
+        writer.join();
+        for (std::thread& reader : readers)
+        {
+            reader.join();
+        }
+
+        ASSERT_EQUAL_HINT(search_server.GetDocumentCount(), 200, "All updates must be applied");
+    }
+
+
+    void TestIndexSegments()
+    {
+        SearchServer search_server("and with"s);
+
+        const int document_count = static_cast<int>(SEGMENT_FLUSH_DOCUMENTS * SEGMENT_MERGE_FACTOR);
+        for (int id = 0; id < document_count; ++id)
+        {
+            search_server.AddDocument(id, (id % 2 == 0) ? "white cat"s : "black dog"s, DocumentStatus::ACTUAL, { id });
+        }
+
+        // Most cats are removed, the merge drops their postings.
+        int removed_count = 0;
+        for (int id = 0; id < document_count; id += 2)
+        {
+            if (id % 10 != 0)
+            {
+                search_server.RemoveDocument(id);
+                ++removed_count;
+            }
+        }
+        search_server.MergeSegments();
+
+        ASSERT_HINT(search_server.GetSegmentCount() <= 2, "Sealed segments must be merged");
+        ASSERT_EQUAL(search_server.GetDocumentCount(), document_count - removed_count);
+
+        const std::vector<Document> found = search_server.FindTopDocuments("white cat"s);
+        ASSERT_EQUAL(found.size(), MAX_RESULT_DOCUMENT_COUNT);
+        for (size_t i = 0; i < found.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found[i].id, document_count - 4 - 10 * static_cast<int>(i), "Removed documents must not be found");
+        }
+
+        const auto [words, status] = search_server.MatchDocument("white cat"s, 10);
+        ASSERT_EQUAL(words.size(), 2u);
+    }
+
+
+    void TestInverseDocumentFreqUpdates()
+    {
+        const std::vector<DocumentInput> documents = {
+            { 1, "white cat and fashion collar", DocumentStatus::ACTUAL, { 8, -3 } },
+            { 2, "fluffy cat fluffy tail", DocumentStatus::ACTUAL, { 7, 2, 7 } },
+            { 3, "groomed dog expressive eyes", DocumentStatus::ACTUAL, { 5, -12, 2, 1 } },
+        };
+
+        SearchServer search_server("and with"s);
+        search_server.AddDocuments(documents);
+        search_server.FindTopDocuments("fluffy cat"s);
+
+        // IDF cached by the first query must follow later updates.
+        search_server.AddDocument(4, "cat in the dog house"s, DocumentStatus::ACTUAL, { 1 });
+        search_server.RemoveDocument(3);
+
+        SearchServer expected_server("and with"s);
+        expected_server.AddDocuments({ documents[0], documents[1] });
+        expected_server.AddDocument(4, "cat in the dog house"s, DocumentStatus::ACTUAL, { 1 });
+
+        const std::vector<Document> found = search_server.FindTopDocuments("fluffy cat dog"s);
+        const std::vector<Document> expected = expected_server.FindTopDocuments("fluffy cat dog"s);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < 1e-6, "IDF must be recomputed after updates");
+        }
+    }
+
+
+    void TestDynamicPruning()
+    {
+        const std::vector<std::string> words = { "cat"s, "dog"s, "white"s, "black"s, "fluffy"s, "tail"s, "collar"s, "eyes"s };
+
+        SearchServer search_server("and with"s);
+        for (int id = 0; id < 3000; ++id)
+        {
+            // Frequent and rare words with different counts, so that word maximums differ.
+            std::string document;
+            for (size_t i = 0; i < words.size(); ++i)
+            {
+                if ((id * 7 + i * 3) % (i + 2) == 0)
+                    document += words[i] + ' ';
+                if ((id + i) % 11 == 0)
+                    document += words[i] + ' ';
+            }
+            document += "word"s + std::to_string(id % 97);
+            search_server.AddDocument(id, document, (id % 5 == 0) ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 13 });
+        }
+
+        // Pruned sequential search must find the same top as the exhaustive parallel one.
+        const std::vector<std::string> queries = { "cat dog"s, "white black fluffy tail"s, "cat dog white black fluffy tail collar eyes"s,
+                                                   "fluffy cat -dog"s, "collar word5 eyes"s, "tail -eyes -collar"s };
+        for (const std::string& query : queries)
+        {
+            for (const size_t top_count : { size_t{ 1 }, MAX_RESULT_DOCUMENT_COUNT, size_t{ 50 } })
+            {
+                const std::vector<Document> found = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_count);
+                const std::vector<Document> expected = search_server.FindTopDocuments(std::execution::par, query,
+                    DocumentStatus::ACTUAL, top_count);
+
+                ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+                for (size_t i = 0; i < expected.size(); ++i)
+                {
+                    ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < 1e-9, query);
+                    ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+                }
+            }
+        }
+    }
+
+
+    void TestMinusWordsExclusion()
+    {
+        SearchServer search_server("and with"s);
+        for (int id = 0; id < 10000; ++id)
+        {
+            search_server.AddDocument(id, (id % 5 == 0) ? "white cat"s : "white cat and dog"s, DocumentStatus::ACTUAL, { id });
+        }
+
+        // Most documents contain the minus word, so the exclusion set is dense.
+        for (const std::vector<Document>& found : { search_server.FindTopDocuments("cat -dog"s, DocumentStatus::ACTUAL, 50),
+                                                    search_server.FindTopDocuments(std::execution::par, "cat -dog"s, DocumentStatus::ACTUAL, 50) })
+        {
+            ASSERT_EQUAL(found.size(), 50u);
+            for (const Document& document : found)
+            {
+                ASSERT_HINT(document.id % 5 == 0, "Documents with minus words must be excluded");
+            }
+            ASSERT_EQUAL(found.front().id, 9995);
+        }
+
+        ASSERT_HINT(search_server.FindTopDocuments("cat -white"s).empty(), "Documents with minus words must be excluded");
+    }
+
+
+    void TestDocumentFilter()
+    {
+        SearchServer search_server("and with"s);
+        const DocumentStatus statuses[] = { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED };
+        for (int id = 0; id < 3000; ++id)
+        {
+            search_server.AddDocument(id, (id % 2 == 0) ? "white cat"s : "white cat and dog"s, statuses[id % 3], { id % 100 });
+        }
+
+        DocumentFilter filter;
+        filter.statuses = DocumentFilter::StatusBit(DocumentStatus::ACTUAL) | DocumentFilter::StatusBit(DocumentStatus::BANNED);
+        filter.min_rating = 10;
+        filter.max_rating = 20;
+        filter.min_id = 500;
+        filter.max_id = 2500;
+        const auto predicate = [](int document_id, DocumentStatus status, int rating)
+        {
+            return (status != DocumentStatus::IRRELEVANT) && (rating >= 10) && (rating <= 20)
+                && (document_id >= 500) && (document_id <= 2500);
+        };
+        const auto ids = [](const std::vector<Document>& documents)
+        {
+            std::vector<int> result;
+            for (const Document& document : documents)
+            {
+                result.push_back(document.id);
+            }
+            return result;
+        };
+
+        // The filter must select the same documents as the equivalent predicate.
+        for (const std::string& query : { "cat"s, "white dog"s, "cat -dog"s })
+        {
+            const std::vector<int> expected = ids(search_server.FindTopDocuments(query, predicate, 100));
+            ASSERT(!expected.empty());
+            ASSERT_EQUAL(ids(search_server.FindTopDocuments(query, filter, 100)), expected);
+            ASSERT_EQUAL(ids(search_server.FindTopDocuments(std::execution::par, query, filter, 100)),
+                ids(search_server.FindTopDocuments(std::execution::par, query, predicate, 100)));
+        }
+
+        const std::vector<int> banned = ids(search_server.FindTopDocuments("cat"s, DocumentStatus::BANNED, 100));
+        ASSERT_EQUAL(banned, ids(search_server.FindTopDocuments("cat"s, DocumentFilter::ForStatus(DocumentStatus::BANNED), 100)));
+        ASSERT_EQUAL(banned.size(), 100u);
+        ASSERT(search_server.FindTopDocuments("cat"s, DocumentStatus::REMOVED).empty());
+        ASSERT_EQUAL(search_server.FindTopDocuments("cat"s, DocumentFilter{}, 100).size(), 100u);
+    }
+
+
+    void TestQueryCache()
+    {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 2 });
+        search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, { 3 });
+        search_server.SetQueryCacheCapacity(2);
+
+        const std::vector<Document> found = search_server.FindTopDocuments("fluffy cat"s);
+        ASSERT_EQUAL(found.size(), 2u);
+
+        // Word order and repeats do not change the parsed query, so it is a hit.
+        const std::vector<Document> cached = search_server.FindTopDocuments(std::execution::par, "cat fluffy cat"s);
+        ASSERT_EQUAL(cached.size(), 2u);
+        ASSERT_EQUAL(cached[0].id, found[0].id);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().hits, 1u);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().misses, 1u);
+
+        // Other status or top count is another query.
+        ASSERT(search_server.FindTopDocuments("fluffy cat"s, DocumentStatus::BANNED).empty());
+        ASSERT_EQUAL(search_server.FindTopDocuments("fluffy cat"s, DocumentStatus::ACTUAL, 1).size(), 1u);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().misses, 3u);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().entry_count, 2u);
+        ASSERT(search_server.GetQueryCacheStatistics().memory_bytes > 0);
+
+        // Custom predicates are not cached.
+        search_server.FindTopDocuments("fluffy cat"s, [](int, DocumentStatus, int) { return true; });
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().misses, 3u);
+
+        // Changes of the documents invalidate the cache.
+        search_server.AddDocument(4, "fluffy fluffy cat"s, DocumentStatus::ACTUAL, { 4 });
+        ASSERT_EQUAL(search_server.FindTopDocuments("fluffy cat"s).size(), 3u);
+        search_server.RemoveDocument(4);
+        ASSERT_EQUAL(search_server.FindTopDocuments("fluffy cat"s).size(), 2u);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().hits, 1u);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().entry_count, 1u);
+
+        search_server.SetQueryCacheCapacity(0);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().entry_count, 0u);
+    }
+
+
+    void TestProcessQueries()
+    {
+        SearchServer search_server("and with"s);
+        for (int id = 0; id < 200; ++id)
+        {
+            search_server.AddDocument(id, "word"s + std::to_string(id % 7) + " common"s, DocumentStatus::ACTUAL, { id });
+        }
+
+        std::vector<std::string> queries;
+        for (int i = 0; i < 50; ++i)
+        {
+            queries.push_back((i % 5 == 0) ? "missing"s : "word"s + std::to_string(i % 9) + " -word3"s);
+        }
+
+        ThreadPool pool(3);
+        ASSERT_EQUAL(pool.GetWorkerCount(), 3u);
+
+        const std::vector<std::vector<Document>> found = ProcessQueries(pool, search_server, queries);
+        ASSERT_EQUAL(found.size(), queries.size());
+        size_t document_count = 0;
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            const std::vector<Document> expected = search_server.FindTopDocuments(queries[i]);
+            ASSERT_EQUAL(found[i].size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j)
+            {
+                ASSERT_EQUAL(found[i][j].id, expected[j].id);
+            }
+            document_count += expected.size();
+        }
+
+        // The joined view walks the results of the queries in order, skipping the empty ones.
+        const JoinedDocuments joined = ProcessQueriesJoined(pool, search_server, queries);
+        ASSERT_EQUAL(joined.size(), document_count);
+        auto it = joined.begin();
+        for (const std::vector<Document>& documents : found)
+        {
+            for (const Document& document : documents)
+            {
+                ASSERT(it != joined.end());
+                ASSERT_EQUAL(it->id, document.id);
+                ++it;
+            }
+        }
+        ASSERT(it == joined.end());
+        ASSERT(ProcessQueriesJoined(search_server, { "missing"s, "absent"s }).empty());
+
+        // Nested calls run on the same workers, an exception reaches the caller.
+        std::atomic<int> sum = 0;
+        pool.ParallelFor(10, [&pool, &sum](size_t i)
+            {
+                pool.ParallelFor(10, [&sum, i](size_t j) { sum += static_cast<int>(i * 10 + j); });
+            });
+        ASSERT_EQUAL(sum.load(), 4950);
+
+        bool is_thrown = false;
+        try
+        {
+            ProcessQueries(pool, search_server, { "common"s, "common --word1"s });
+        }
+        catch (const std::invalid_argument&)
+        {
+            is_thrown = true;
+        }
+        ASSERT_HINT(is_thrown, "An invalid query must throw");
+
+        // The caller of ParallelFor runs only its own indices, not tasks queued before them.
+        ThreadPool busy_pool(1);
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        busy_pool.Submit([released]() { released.wait(); });
+        std::promise<std::thread::id> queued_task_thread;
+        busy_pool.Submit([&queued_task_thread]() { queued_task_thread.set_value(std::this_thread::get_id()); });
+
+        std::atomic<int> caller_indices = 0;
+        busy_pool.ParallelFor(4, [&caller_indices](size_t) { ++caller_indices; });
+        ASSERT_EQUAL(caller_indices.load(), 4);
+
+        release.set_value();
+        ASSERT(queued_task_thread.get_future().get() != std::this_thread::get_id());
+    }
+
+
+    void TestAsyncQueries()
+    {
+        SearchServer search_server("and with"s);
+        for (int id = 0; id < 100; ++id)
+        {
+            search_server.AddDocument(id, "word"s + std::to_string(id % 5) + " common"s,
+                (id % 4 == 0) ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id });
+        }
+
+        {
+            std::future<std::vector<Document>> future = search_server.FindTopDocumentsAsync("word2 -word3"s);
+            const std::vector<Document> expected = search_server.FindTopDocuments("word2 -word3"s);
+            const std::vector<Document> found = future.get();
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+            }
+
+            const std::vector<Document> banned = search_server.FindTopDocumentsAsync("common"s,
+                DocumentFilter::ForStatus(DocumentStatus::BANNED), 50).get();
+            ASSERT_EQUAL(banned.size(), 25u);
+        }
+
+        {
+            const std::vector<std::string> queries = { "word0"s, "word1 common"s, "missing"s };
+            std::vector<std::future<std::vector<Document>>> futures = search_server.FindTopDocumentsAsync(queries);
+            ASSERT_EQUAL(futures.size(), queries.size());
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                ASSERT_EQUAL(futures[i].get().size(), search_server.FindTopDocuments(queries[i]).size());
+            }
+        }
+
+        // A stopped query and an invalid one deliver their exceptions through the future.
+        {
+            QueryControl control;
+            control.cancellation.Cancel();
+            std::future<std::vector<Document>> future = search_server.FindTopDocumentsAsync("common"s,
+                DocumentFilter::ForStatus(DocumentStatus::ACTUAL), MAX_RESULT_DOCUMENT_COUNT, control);
+
+            bool is_cancelled = false;
+            try
+            {
+                future.get();
+            }
+            catch (const QueryCancelledError&)
+            {
+                is_cancelled = true;
+            }
+            ASSERT_HINT(is_cancelled, "A cancelled query must not run");
+        }
+
+        {
+            std::vector<std::future<std::vector<Document>>> futures = search_server.FindTopDocumentsAsync(
+                std::vector<std::string>{ "common"s, "word1"s }, DocumentFilter::ForStatus(DocumentStatus::ACTUAL),
+                MAX_RESULT_DOCUMENT_COUNT, QueryControl::WithTimeout(std::chrono::seconds(-1)));
+
+            size_t expired_count = 0;
+            for (std::future<std::vector<Document>>& future : futures)
+            {
+                try
+                {
+                    future.get();
+                }
+                catch (const QueryDeadlineError&)
+                {
+                    ++expired_count;
+                }
+            }
+            ASSERT_EQUAL_HINT(expired_count, 2u, "A query past its deadline must not run");
+        }
+
+        {
+            bool is_thrown = false;
+            try
+            {
+                search_server.FindTopDocumentsAsync("common --word1"s).get();
+            }
+            catch (const std::invalid_argument&)
+            {
+                is_thrown = true;
+            }
+            ASSERT_HINT(is_thrown, "An invalid query must throw");
+        }
+    }
+
+
+    void TestConcurrentMap()
+    {
+        {
+            ConcurrentMap<int, int> map(7);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&map]()
+                    {
+                        for (int key = 0; key < 1000; ++key)
+                        {
+                            map[key].ref_to_value += key;
+                        }
+                    });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            ASSERT_EQUAL(map.GetSize(), 1000u);
+            ASSERT_EQUAL(map.Find(10).value(), 40);
+
+            map.Rehash(64);
+            ASSERT_EQUAL(map.GetBucketCount(), 64u);
+            ASSERT_EQUAL(map.Find(999).value(), 3996);
+
+            ASSERT(map.Erase(10));
+            ASSERT(!map.Erase(10));
+            ASSERT(!map.Contains(10));
+            ASSERT(!map.Find(10).has_value());
+
+            std::atomic<long long> sum = 0;
+            map.ForEach(std::execution::par, [&sum](int, int value) { sum += value; });
+            ASSERT_EQUAL(sum.load(), 4LL * (999 * 1000 / 2 - 10));
+
+            const std::map<int, int> ordinary_map = map.BuildOrdinaryMap();
+            ASSERT_EQUAL(ordinary_map.size(), 999u);
+            ASSERT_EQUAL(ordinary_map.begin()->first, 0);
+        }
+
+        {
+            // String keys are found by any string without a copy.
+            ConcurrentMap<std::string, int> map(16);
+            map["cat"s].ref_to_value = 1;
+            map["dog"s].ref_to_value = 2;
+
+            const std::string_view key = std::string_view("cat and dog").substr(8);
+            ASSERT_EQUAL(map.Find(key).value(), 2);
+            ASSERT(map.Contains("cat"));
+            ASSERT(map.Erase(std::string_view("cat")));
+            ASSERT_EQUAL(map.GetSize(), 1u);
+        }
+    }
+
+
+    void TestRemoveDuplicates()
+    {
+        {
+            SearchServer search_server("and with"s);
+            search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+            search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+            search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+            search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+            search_server.AddDocuments({ { 5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 } },
+                                         { 6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 } },
+                                         { 7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, { 1, 2 } } });
+            search_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+            search_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+
+            ASSERT_EQUAL(search_server.GetDocumentFingerprint(1), search_server.GetDocumentFingerprint(5));
+            ASSERT(search_server.GetDocumentFingerprint(1) != search_server.GetDocumentFingerprint(6));
+
+            const std::vector<int> removed_ids = RemoveDuplicates(search_server);
+            ASSERT_EQUAL(removed_ids, std::vector<int>({ 3, 4, 5, 7 }));
+            ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+            ASSERT(RemoveDuplicates(search_server).empty());
+        }
+
+        {
+            // Fingerprints are restored from a snapshot.
+            SearchServer search_server(""s);
+            search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+            const std::string path = (std::filesystem::temp_directory_path() / "search_server_duplicates.snapshot").string();
+            search_server.SaveSnapshot(path);
+            SearchServer loaded = SearchServer::LoadSnapshot(path);
+            std::filesystem::remove(path);
+
+            loaded.AddDocument(2, "cat white cat"s, DocumentStatus::ACTUAL, { 1 });
+            ASSERT_EQUAL(RemoveDuplicates(loaded), std::vector<int>({ 2 }));
+        }
+
+        {
+            SearchServer search_server(""s);
+            const std::string text = "a b c d e f g h i j k l m n o p q r s t"s;
+            search_server.AddDocument(1, text, DocumentStatus::ACTUAL, { 1 });
+            // 19 of 21 words are common with the first document.
+            search_server.AddDocument(2, text + " u"s, DocumentStatus::ACTUAL, { 1 });
+            // 10 of 30 words are common with the first document.
+            search_server.AddDocument(3, "a b c d e f g h i j v w x y z aa bb cc dd ee ff gg hh ii jj kk ll mm nn oo"s,
+                DocumentStatus::ACTUAL, { 1 });
+            search_server.AddDocument(4, "u v"s, DocumentStatus::ACTUAL, { 1 });
+
+            ASSERT_EQUAL(RemoveNearDuplicates(search_server, 0.9), std::vector<int>({ 2 }));
+            ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+
+            bool is_thrown = false;
+            try
+            {
+                RemoveNearDuplicates(search_server, 0.0);
+            }
+            catch (const std::invalid_argument&)
+            {
+                is_thrown = true;
+            }
+            ASSERT(is_thrown);
+        }
+    }
+
+
+    void TestMetrics()
+    {
+        for (const uint64_t value : { 0ull, 7ull, 8ull, 100ull, 12345ull, 987654321ull, ~0ull })
+        {
+            const double bucket_value = static_cast<double>(LatencyHistogram::GetBucketValue(LatencyHistogram::GetBucket(value)));
+            ASSERT(std::abs(bucket_value - value) <= value / LatencyHistogram::SUB_BUCKET_COUNT);
+        }
+
+        Metrics::Reset();
+
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "white cat and fashion collar"s, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 2 });
+        search_server.AddDocuments({ { 3, "groomed cat expressive eyes"s, DocumentStatus::BANNED, { 3 } },
+                                     { 4, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 4 } } });
+        search_server.RemoveDocument(4);
+
+        search_server.FindTopDocuments("cat -collar"s);
+        search_server.FindTopDocuments(std::execution::par, "cat -collar"s);
+
+        MetricsSnapshot snapshot = Metrics::GetSnapshot();
+        ASSERT_EQUAL(snapshot[MetricCounter::ADDED_DOCUMENTS], 4u);
+        ASSERT_EQUAL(snapshot[MetricCounter::REMOVED_DOCUMENTS], 1u);
+        ASSERT_EQUAL(snapshot[MetricCounter::QUERIES], 2u);
+        ASSERT_EQUAL(snapshot[MetricCounter::CANDIDATE_DOCUMENTS], 6u);
+        ASSERT_EQUAL(snapshot[MetricCounter::EXCLUDED_DOCUMENTS], 2u);
+        ASSERT_EQUAL(snapshot[MetricCounter::FILTERED_DOCUMENTS], 2u);
+        ASSERT_EQUAL(snapshot[MetricStage::ADD_DOCUMENT].count, 2u);
+        ASSERT_EQUAL(snapshot[MetricStage::ADD_DOCUMENTS].count, 1u);
+        ASSERT_EQUAL(snapshot[MetricStage::REMOVE_DOCUMENT].count, 1u);
+        ASSERT_EQUAL(snapshot[MetricStage::QUERY].count, 2u);
+        ASSERT_EQUAL(snapshot[MetricStage::QUERY_PARSE].count, 2u);
+        ASSERT_EQUAL(snapshot[MetricStage::MINUS_EXCLUSION].count, 2u);
+        ASSERT_EQUAL(snapshot[MetricStage::TOP_SELECTION].count, 2u);
+        ASSERT(snapshot[MetricStage::QUERY].p50_ns <= snapshot[MetricStage::QUERY].max_ns);
+        ASSERT(snapshot[MetricStage::QUERY].total_ns >= snapshot[MetricStage::QUERY_PARSE].total_ns);
+
+        std::ostringstream dump;
+        dump << snapshot;
+        ASSERT(dump.str().find("query_parse count=2 "s) != std::string::npos);
+
+        // A disabled registry records nothing.
+        Metrics::SetEnabled(false);
+        search_server.FindTopDocuments("cat"s);
+        Metrics::SetEnabled(true);
+        snapshot = Metrics::GetSnapshot();
+        ASSERT_EQUAL(snapshot[MetricCounter::QUERIES], 2u);
+        ASSERT_EQUAL(snapshot[MetricStage::QUERY].count, 2u);
+
+        Metrics::Reset();
+        ASSERT_EQUAL(Metrics::GetSnapshot()[MetricCounter::QUERIES], 0u);
+
+        // Metrics of finished threads are kept after their blocks are freed.
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i)
+        {
+            threads.emplace_back([&search_server]() { search_server.FindTopDocuments("cat"s); });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        snapshot = Metrics::GetSnapshot();
+        ASSERT_EQUAL(snapshot[MetricCounter::QUERIES], 4u);
+        ASSERT_EQUAL(snapshot[MetricStage::QUERY].count, 4u);
+    }
+
+
+    void TestExplainQuery()
+    {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "white cat and fashion collar"s, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 2 });
+        search_server.AddDocument(3, "groomed cat expressive eyes"s, DocumentStatus::BANNED, { 3 });
+        search_server.SetQueryCacheCapacity(8);
+
+        // A traced query bypasses the cache even when the query is cached.
+        const std::string query = "fluffy cat and -collar -parrot"s;
+        const std::vector<Document> found = search_server.FindTopDocuments(query);
+        const auto [documents, profile] = search_server.ExplainTopDocuments(query);
+        ASSERT_EQUAL(documents.size(), 1u);
+        ASSERT_EQUAL(documents[0].id, found[0].id);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().hits, 0u);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().misses, 1u);
+
+        ASSERT_EQUAL(profile.plus_terms.size(), 2u);
+        ASSERT_EQUAL(profile.plus_terms[0].word, "cat"s);
+        ASSERT_EQUAL(profile.plus_terms[0].posting_count, 3u);
+        ASSERT_EQUAL(profile.plus_terms[1].word, "fluffy"s);
+        ASSERT_EQUAL(profile.plus_terms[1].posting_count, 1u);
+        ASSERT(std::abs(profile.plus_terms[1].inverse_document_freq - std::log(3.0)) < 1e-9);
+        ASSERT_EQUAL(profile.minus_terms.size(), 2u);
+        ASSERT_EQUAL(profile.minus_terms[0].posting_count, 1u);
+        ASSERT_EQUAL(profile.minus_terms[1].posting_count, 0u);
+        ASSERT(profile.stop_words == std::vector<std::string>{ "and"s });
+
+        ASSERT_EQUAL(profile.excluded_documents, 1u);
+        ASSERT_EQUAL(profile.filtered_documents, 1u);
+        ASSERT_EQUAL(profile.scored_documents, 1u);
+        ASSERT(profile.GetStageTime(MetricStage::QUERY).count() > 0);
+        ASSERT(profile.GetStageTime(MetricStage::QUERY) >= profile.GetStageTime(MetricStage::QUERY_PARSE));
+
+        // The trace is collected whether the metrics registry is enabled or not.
+        Metrics::SetEnabled(false);
+        const auto [par_documents, par_profile] = search_server.ExplainTopDocuments(std::execution::par, query,
+            DocumentFilter::ForStatus(DocumentStatus::ACTUAL));
+        Metrics::SetEnabled(true);
+        ASSERT_EQUAL(par_documents.size(), 1u);
+        ASSERT_EQUAL(par_documents[0].id, documents[0].id);
+        ASSERT_EQUAL(par_profile.excluded_documents, 1u);
+        ASSERT_EQUAL(par_profile.filtered_documents, 1u);
+        ASSERT_EQUAL(par_profile.scored_documents, 1u);
+        ASSERT(par_profile.GetStageTime(MetricStage::QUERY).count() > 0);
+
+        std::ostringstream dump;
+        dump << profile;
+        ASSERT(dump.str().find("stop and"s) != std::string::npos);
+    }
+
+
+    void TestRequestTracker()
+    {
+        using namespace std::chrono_literals;
+
+        RequestTracker tracker(60s);
+        ASSERT(tracker.GetWindow() == 60s);
+
+        const RequestTracker::Clock::time_point start{ 1'000'000s };
+        tracker.Record(false, 1us, start);
+        tracker.Record(true, 2us, start + 500ms);
+        tracker.Record(false, 1ms, start);
+        tracker.Record(true, 3us, start + 30s);
+
+        RequestStatistics statistics = tracker.GetStatistics(start + 30s);
+        ASSERT_EQUAL(statistics.request_count, 4u);
+        ASSERT_EQUAL(statistics.no_result_count, 2u);
+        ASSERT_EQUAL(statistics.total_ns, 1'006'000u);
+        ASSERT(statistics.p50_ns < 3000);
+        ASSERT(statistics.max_ns > 900'000);
+
+        // Seconds after the time are not counted, the seconds before the window have expired.
+        ASSERT_EQUAL(tracker.GetStatistics(start + 29s).request_count, 3u);
+        ASSERT_EQUAL(tracker.GetStatistics(start + 59s).request_count, 4u);
+        ASSERT_EQUAL(tracker.GetStatistics(start + 60s).request_count, 1u);
+
+        // The bucket of a second is reused a window later, older requests are dropped.
+        tracker.Record(false, 1us, start + 60s);
+        tracker.Record(true, 1us, start);
+        statistics = tracker.GetStatistics(start + 60s);
+        ASSERT_EQUAL(statistics.request_count, 2u);
+        ASSERT_EQUAL(statistics.no_result_count, 1u);
+
+        try
+        {
+            RequestTracker empty_window(0s);
+            ASSERT_HINT(false, "A window shorter than a second must be rejected"s);
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+
+        SearchServer search_server("and with"s);
+        for (int id = 0; id < 20; ++id)
+        {
+            search_server.AddDocument(id, "word"s + std::to_string(id % 4), DocumentStatus::ACTUAL, { id });
+        }
+
+        RequestQueue request_queue(search_server);
+        request_queue.AddFindRequest("word1"s);
+        request_queue.AddFindRequest("missing"s);
+        request_queue.AddFindRequest("word2"s, DocumentStatus::BANNED);
+        ASSERT_EQUAL(request_queue.GetNoResultRequests(), 2);
+
+        // Worker threads of a batch record into the same tracker.
+        std::vector<std::string> queries;
+        for (int i = 0; i < 100; ++i)
+        {
+            queries.push_back("word"s + std::to_string(i % 5));
+        }
+        ThreadPool pool(4);
+        ProcessQueries(pool, search_server, queries, request_queue.GetTracker());
+        statistics = request_queue.GetStatistics();
+        ASSERT_EQUAL(statistics.request_count, 103u);
+        ASSERT_EQUAL(statistics.no_result_count, 22u);
+
+        // Status requests go through the filter, so they are served by the cache.
+        search_server.SetQueryCacheCapacity(4);
+        request_queue.AddFindRequest("word1"s, DocumentStatus::ACTUAL);
+        request_queue.AddFindRequest("word1"s);
+        ASSERT_EQUAL(search_server.GetQueryCacheStatistics().hits, 1u);
+    }
+
+
+    void TestLoadCorpus()
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "search_server_test.corpus").string();
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "1\tACTUAL\t8,-3\twhite cat and fashion collar\n"s
+                 << "\n"s
+                 << "2\t2\t\tfluffy cat fluffy tail\r\n"s
+                 << "3\tIRRELEVANT\t5\tgroomed dog with collar"s;
+        }
+
+        ThreadPool pool(2);
+        SearchServer search_server("and with"s);
+        ASSERT_EQUAL(LoadCorpus(pool, search_server, path), 3u);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+
+        const auto [words, status] = search_server.MatchDocument("fluffy tail"s, 2);
+        ASSERT_EQUAL(words.size(), 2u);
+        ASSERT(status == DocumentStatus::BANNED);
+
+        const std::vector<Document> found = search_server.FindTopDocuments("collar"s, DocumentStatus::IRRELEVANT);
+        ASSERT_EQUAL(found.size(), 1u);
+        ASSERT_EQUAL(found[0].id, 3);
+        ASSERT_EQUAL(found[0].rating, 5);
+        ASSERT_EQUAL(search_server.FindTopDocuments("cat"s)[0].rating, 2);
+
+        // Documents longer than a chunk are not split, however the file is cut.
+        {
+            std::ofstream file(path, std::ios::binary);
+            for (int id = 10; id < 13; ++id)
+            {
+                file << id << "\tACTUAL\t1\t"s;
+                for (int i = 0; i < 300'000; ++i)
+                    file << "w"s << id << "_"s << (i % 10) << ' ';
+                file << '\n';
+            }
+        }
+        ASSERT_EQUAL(LoadCorpus(pool, search_server, path), 3u);
+        ASSERT_EQUAL(search_server.GetWordFrequencies(11).size(), 10u);
+
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "20\tACTUAL\t1\tgood line\n"s
+                 << "21\tUNKNOWN\t1\tbad status\n"s;
+        }
+        std::string error;
+        try
+        {
+            LoadCorpus(pool, search_server, path);
+        }
+        catch (const std::runtime_error& e)
+        {
+            error = e.what();
+        }
+        std::filesystem::remove(path);
+
+        ASSERT_EQUAL(error, "Malformed corpus line 2"s);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 6);
+    }
+
 
     void TestSearchServer()
     {
@@ -178,5 +1360,27 @@ namespace search_server_testing
         RUN_TEST(TestUserPredicate);
         RUN_TEST(TestDocumentStatus);
         RUN_TEST(TestRelevanceCalculations);
+        RUN_TEST(TestRemoveDocument);
+        RUN_TEST(TestCopyServer);
+        RUN_TEST(TestTopDocumentsCount);
+        RUN_TEST(TestSnapshot);
+        RUN_TEST(TestWordSplitting);
+        RUN_TEST(TestPostingList);
+        RUN_TEST(TestAddDocuments);
+        RUN_TEST(TestConcurrentUpdates);
+        RUN_TEST(TestIndexSegments);
+        RUN_TEST(TestInverseDocumentFreqUpdates);
+        RUN_TEST(TestDynamicPruning);
+        RUN_TEST(TestMinusWordsExclusion);
+        RUN_TEST(TestDocumentFilter);
+        RUN_TEST(TestQueryCache);
+        RUN_TEST(TestProcessQueries);
+        RUN_TEST(TestAsyncQueries);
+        RUN_TEST(TestConcurrentMap);
+        RUN_TEST(TestRemoveDuplicates);
+        RUN_TEST(TestMetrics);
+        RUN_TEST(TestExplainQuery);
+        RUN_TEST(TestRequestTracker);
+        RUN_TEST(TestLoadCorpus);
     }
 }
@@ -17,6 +17,28 @@ namespace search_server_testing
     void TestUserPredicate();
     void TestDocumentStatus();
     void TestRelevanceCalculations();
+    void TestRemoveDocument();
+    void TestCopyServer();
+    void TestTopDocumentsCount();
+    void TestSnapshot();
+    void TestWordSplitting();
+    void TestPostingList();
+    void TestAddDocuments();
+    void TestConcurrentUpdates();
+    void TestIndexSegments();
+    void TestInverseDocumentFreqUpdates();
+    void TestDynamicPruning();
+    void TestMinusWordsExclusion();
+    void TestDocumentFilter();
+    void TestQueryCache();
+    void TestProcessQueries();
+    void TestAsyncQueries();
+    void TestConcurrentMap();
+    void TestRemoveDuplicates();
+    void TestMetrics();
+    void TestExplainQuery();
+    void TestRequestTracker();
+    void TestLoadCorpus();
 
     void TestSearchServer();
 }
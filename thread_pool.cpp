@@ -0,0 +1,110 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Pool and queue of the worker running on this thread.
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local size_t current_queue = 0;
+}
+
+ThreadPool::ThreadPool(size_t worker_count)
+{
+    worker_count = std::max<size_t>(worker_count, 1);
+
+    queues_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i)
+        queues_.push_back(std::make_unique<WorkerQueue>());
+
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i)
+        workers_.emplace_back([this, i]() { WorkerLoop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        is_stopping_ = true;
+    }
+    wake_.notify_all();
+
+    for (std::thread& worker : workers_)
+        worker.join();
+}
+
+void ThreadPool::Submit(Task task)
+{
+    const size_t queue_index = (current_pool == this)
+        ? current_queue
+        : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+    {
+        // Counted before the task is visible, so taking it never makes the count negative.
+        std::lock_guard<std::mutex> lock(queues_[queue_index]->mutex);
+        ++queued_count_;
+        queues_[queue_index]->tasks.push_back(std::move(task));
+    }
+
+    {
+        // A worker checks the count under the mutex, so it either sees the task or gets the notification.
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_.notify_one();
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+    current_pool = this;
+    current_queue = index;
+
+    while (true)
+    {
+        if (TryRunTask())
+            continue;
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this]() { return is_stopping_ || (queued_count_.load() > 0); });
+        if (is_stopping_ && (queued_count_.load() == 0))
+            return;
+    }
+}
+
+bool ThreadPool::TryRunTask()
+{
+    Task task;
+
+    for (size_t i = 0; (i < queues_.size()) && !task; ++i)
+    {
+        WorkerQueue& queue = *queues_[(current_queue + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        // The own queue is used as a stack, other queues are robbed from the oldest task.
+        if (i == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    --queued_count_;
+    task();
+    return true;
+}
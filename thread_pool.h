@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* @brief Persistent pool of worker threads with work stealing.
+ *        Every worker has its own task queue: it takes tasks from the back of it
+ *        and, when it is empty, steals from the front of the other queues, so one
+ *        long task does not hold back the tasks queued after it. Tasks submitted
+ *        by a worker go to its own queue, other tasks are spread round-robin. */
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    /* @param worker_count - count of worker threads, at least one is started. */
+    explicit ThreadPool(size_t worker_count = std::thread::hardware_concurrency());
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs the queued tasks and stops the workers.
+    ~ThreadPool();
+
+    inline size_t GetWorkerCount() const noexcept
+    {
+        return workers_.size();
+    }
+
+    void Submit(Task task);
+
+    /* @brief Runs function(i) for every i in [0, count) on the workers and the calling thread.
+     *        Indices are claimed one at a time by the caller and by up to a task per worker.
+     *        The caller runs only indices of its own call, never other queued tasks, so the
+     *        call may be nested and its latency does not depend on unrelated tasks.
+     * @throw The first exception thrown by the function, after all indices are finished. */
+    template <typename Function>
+    void ParallelFor(size_t count, Function function);
+
+    /* @return Pool with a worker per hardware thread, created on first use. */
+    static ThreadPool& GetDefault();
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /* Indices of one ParallelFor call. Shared with its tasks, as tasks that find
+     * no index left may run after the call has returned. */
+    struct Batch
+    {
+        std::atomic<size_t> next{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining = 0;
+        std::exception_ptr exception;
+    };
+
+    void WorkerLoop(size_t index);
+
+    /* @brief Runs one queued task on a worker: from the back of its own queue
+     *        or from the front of another queue.
+     * @return false if all queues are empty. */
+    bool TryRunTask();
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> queued_count_{ 0 };
+    bool is_stopping_ = false;
+
+    std::atomic<size_t> next_queue_{ 0 };
+};
+
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function)
+{
+    if (count == 0)
+        return;
+
+    const auto batch = std::make_shared<Batch>();
+    batch->remaining = count;
+
+    // The function is used only for a claimed index, all of them finish before the call returns.
+    const auto run_indices = [batch, &function, count]()
+    {
+        for (size_t i = batch->next.fetch_add(1); i < count; i = batch->next.fetch_add(1))
+        {
+            std::exception_ptr exception;
+            try
+            {
+                function(i);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            // Decremented under the mutex, so the caller can not leave before the notification.
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (exception && !batch->exception)
+                batch->exception = exception;
+            if (--batch->remaining == 0)
+                batch->done.notify_all();
+        }
+    };
+
+    const size_t task_count = std::min(count - 1, workers_.size());
+    for (size_t i = 0; i < task_count; ++i)
+        Submit(run_indices);
+
+    run_indices();
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done.wait(lock, [&batch]() { return batch->remaining == 0; });
+    if (batch->exception)
+        std::rethrow_exception(batch->exception);
+}
@@ -0,0 +1,95 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+    // Documents per parallel selection task.
+    const size_t SELECTION_CHUNK_SIZE = 4096;
+}
+
+TopDocuments::TopDocuments(size_t max_count)
+    : max_count_(max_count)
+{
+}
+
+bool TopDocuments::Add(const Document& document)
+{
+    if (max_count_ == 0)
+        return false;
+
+    // IsMoreRelevant acts as "less", so the front of the heap is the worst document.
+    if (heap_.size() < max_count_)
+    {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        return true;
+    }
+
+    if (!IsMoreRelevant(document, heap_.front()))
+        return false;
+
+    std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    heap_.back() = document;
+    std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return true;
+}
+
+void TopDocuments::Merge(const TopDocuments& other)
+{
+    for (const Document& document : other.heap_)
+    {
+        Add(document);
+    }
+}
+
+std::vector<Document> TopDocuments::Extract()
+{
+    std::vector<Document> result = std::move(heap_);
+    heap_.clear();
+
+    std::sort_heap(result.begin(), result.end(), IsMoreRelevant);
+    return result;
+}
+
+std::vector<Document> SelectTopDocuments(const std::execution::sequenced_policy&,
+    const std::vector<Document>& documents, size_t top_count)
+{
+    TopDocuments top_documents(top_count);
+    for (const Document& document : documents)
+    {
+        top_documents.Add(document);
+    }
+    return top_documents.Extract();
+}
+
+std::vector<Document> SelectTopDocuments(const std::execution::parallel_policy&,
+    const std::vector<Document>& documents, size_t top_count)
+{
+    if (documents.size() <= SELECTION_CHUNK_SIZE)
+        return SelectTopDocuments(std::execution::seq, documents, top_count);
+
+    const size_t chunk_count = (documents.size() + SELECTION_CHUNK_SIZE - 1) / SELECTION_CHUNK_SIZE;
+    std::vector<TopDocuments> partial_tops(chunk_count, TopDocuments(top_count));
+    std::vector<size_t> chunks(chunk_count);
+    std::iota(chunks.begin(), chunks.end(), 0);
+
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+        [&documents, &partial_tops](size_t chunk)
+        {
+            const size_t first = chunk * SELECTION_CHUNK_SIZE;
+            const size_t last = std::min(first + SELECTION_CHUNK_SIZE, documents.size());
+            for (size_t i = first; i < last; ++i)
+            {
+                partial_tops[chunk].Add(documents[i]);
+            }
+        });
+
+    TopDocuments top_documents(top_count);
+    for (const TopDocuments& partial_top : partial_tops)
+    {
+        top_documents.Merge(partial_top);
+    }
+    return top_documents.Extract();
+}
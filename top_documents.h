@@ -0,0 +1,74 @@
+#pragma once
+
+#include "document.h"
+
+#include <cmath>
+#include <execution>
+#include <vector>
+
+// Relevances closer than this value are considered equal.
+const double RELEVANCE_EPSILON = 1e-6;
+
+/* @brief Ranking order of search results: higher relevance first,
+ *        documents with equal relevance are ranked by rating.
+ * @return true if lhs is ranked above rhs. */
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+    return (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_EPSILON) ?
+        lhs.rating > rhs.rating : lhs.relevance > rhs.relevance;
+}
+
+
+/* @brief Bounded collector of the best ranked documents.
+ *        Keeps at most max_count documents in a heap whose top is the
+ *        worst kept document, so every addition costs O(log max_count). */
+class TopDocuments
+{
+public:
+    explicit TopDocuments(size_t max_count);
+
+    /* @brief Offers a document to the collector.
+     * @param document - candidate document.
+     * @return true if the document was kept. */
+    bool Add(const Document& document);
+
+    /* @brief Offers all documents kept by another collector. */
+    void Merge(const TopDocuments& other);
+
+    inline bool IsFull() const noexcept
+    {
+        return heap_.size() >= max_count_;
+    }
+
+    inline size_t size() const noexcept
+    {
+        return heap_.size();
+    }
+
+    /* @return Lowest ranked document kept. The collector must not be empty. */
+    inline const Document& GetWorst() const
+    {
+        return heap_.front();
+    }
+
+    /* @brief Takes the kept documents out of the collector.
+     * @return Documents ordered by IsMoreRelevant. */
+    std::vector<Document> Extract();
+
+private:
+    size_t max_count_;
+    std::vector<Document> heap_;
+};
+
+
+/* @brief Selection of the best ranked documents without sorting all of them.
+ * @param documents - documents found on query.
+ * @param top_count - maximum count of documents in the result.
+ * @return Best documents ordered by IsMoreRelevant. */
+std::vector<Document> SelectTopDocuments(const std::execution::sequenced_policy&,
+    const std::vector<Document>& documents, size_t top_count);
+
+/* Every thread collects the best documents of its own part of the input,
+ * the partial results are merged afterwards. */
+std::vector<Document> SelectTopDocuments(const std::execution::parallel_policy&,
+    const std::vector<Document>& documents, size_t top_count);
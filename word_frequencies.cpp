@@ -0,0 +1,36 @@
+#include "word_frequencies.h"
+
+#include <algorithm>
+
+namespace
+{
+    bool IsLessWord(const WordFrequency& lhs, const WordFrequency& rhs) noexcept
+    {
+        return lhs.word < rhs.word;
+    }
+}
+
+WordFrequencies::WordFrequencies(std::shared_ptr<const Entries> entries)
+    : entries_(std::move(entries))
+{
+}
+
+std::shared_ptr<const WordFrequencies::Entries> WordFrequencies::MakeEntries(Entries entries)
+{
+    if (!std::is_sorted(entries.begin(), entries.end(), IsLessWord))
+        std::sort(entries.begin(), entries.end(), IsLessWord);
+
+    return std::make_shared<const Entries>(std::move(entries));
+}
+
+double WordFrequencies::GetFrequency(std::string_view word) const noexcept
+{
+    const auto it = std::lower_bound(begin(), end(), WordFrequency{ word, 0.0 }, IsLessWord);
+    return ((it != end()) && (it->word == word)) ? it->frequency : 0.0;
+}
+
+bool WordFrequencies::operator==(const WordFrequencies& other) const noexcept
+{
+    return std::equal(begin(), end(), other.begin(), other.end(),
+        [](const WordFrequency& lhs, const WordFrequency& rhs) { return (lhs.word == rhs.word) && (lhs.frequency == rhs.frequency); });
+}
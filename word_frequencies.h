@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/* @param word - word of a document.
+ * @param frequency - TF of the word in the document. */
+struct WordFrequency
+{
+    std::string_view word;
+    double frequency = 0.0;
+};
+
+/* @brief Read-only view of the words of a document with their TF, sorted by word.
+ *        The view shares the entries with the forward index of the server, so
+ *        getting it copies and allocates nothing. The entries are never changed
+ *        and live while any view holds them, so a view stays valid after the
+ *        document is removed and may be read by many threads. */
+class WordFrequencies
+{
+public:
+    using Entries = std::vector<WordFrequency>;
+    using Iterator = Entries::const_iterator;
+
+    WordFrequencies() = default;
+
+    explicit WordFrequencies(std::shared_ptr<const Entries> entries);
+
+    /* @brief Entries sorted by word, shared by the returned views.
+     * @param entries - words of a document with their TF, each word once. */
+    static std::shared_ptr<const Entries> MakeEntries(Entries entries);
+
+    inline Iterator begin() const noexcept
+    {
+        return entries_ ? entries_->begin() : Iterator();
+    }
+
+    inline Iterator end() const noexcept
+    {
+        return entries_ ? entries_->end() : Iterator();
+    }
+
+    inline size_t size() const noexcept
+    {
+        return entries_ ? entries_->size() : 0;
+    }
+
+    inline bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    /* @return TF of the word, 0 if the document does not contain it. */
+    double GetFrequency(std::string_view word) const noexcept;
+
+    bool operator==(const WordFrequencies& other) const noexcept;
+
+    inline bool operator!=(const WordFrequencies& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+private:
+    std::shared_ptr<const Entries> entries_;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/* @brief Mixing of the bits of a hash (the finalizer of splitmix64),
+ *        so that close values get unrelated hashes. */
+inline uint64_t MixHash(uint64_t value) noexcept
+{
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+/* @return Hash of the word, the same in every server and process. */
+inline uint64_t HashWord(const std::string_view word) noexcept
+{
+    // FNV-1a, std::hash is not required to be stable between runs.
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (const char c : word)
+    {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    }
+    return MixHash(hash);
+}